@@ -0,0 +1,259 @@
+#pragma once
+
+#include "graph.h"
+#include "parallel.h"
+#include "router.h"
+
+#include <algorithm>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// A* search with ALT lower bounds: by the triangle inequality, d(v, t) is at least
+// d(v, L) - d(t, L) and d(L, t) - d(L, v) for every landmark L.
+// The first landmark is the vertex with most outgoing edges, each next one is the vertex farthest
+// in hops from the ones picked before. Distances to and from all of them are computed in parallel.
+template <typename Weight>
+class AltRouter {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+    static_assert(std::numeric_limits<Weight>::has_infinity, "AltRouter stores unreachable vertices as infinity");
+
+public:
+    using RouteInfo = typename Router<Weight>::RouteInfo;
+
+    // Vertex-major tables: the distances for vertex v are at [v * landmarks.size(), (v + 1) * landmarks.size()).
+    struct LandmarkTables {
+        std::vector<VertexId> landmarks;
+        std::vector<Weight> to_landmarks;
+        std::vector<Weight> from_landmarks;
+    };
+
+    AltRouter(const Graph& graph, size_t landmark_count, size_t thread_count = 1);
+
+    // Takes tables computed before for the same graph, e.g. loaded from a file.
+    AltRouter(const Graph& graph, LandmarkTables tables);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to, SearchStats* stats = nullptr) const;
+
+    const LandmarkTables& GetLandmarkTables() const {
+        return tables_;
+    }
+
+private:
+    using QueueItem = std::pair<Weight, VertexId>;
+    using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr Weight NO_PATH = std::numeric_limits<Weight>::infinity();
+
+    void CheckGraph() const {
+        for (EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+            if (graph_.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+        }
+    }
+
+    std::vector<VertexId> SelectLandmarks(size_t landmark_count) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        constexpr size_t NOT_REACHED = std::numeric_limits<size_t>::max();
+        std::vector<VertexId> landmarks;
+        std::vector<size_t> hops_to_landmarks(vertex_count, NOT_REACHED);
+        auto out_degree = [this](VertexId vertex) {
+            const auto edges = graph_.GetIncidentEdges(vertex);
+            return std::distance(edges.begin(), edges.end());
+        };
+        VertexId next_landmark = 0;
+        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+            if (out_degree(vertex) > out_degree(next_landmark)) {
+                next_landmark = vertex;
+            }
+        }
+        while (landmarks.size() < std::min(landmark_count, vertex_count)) {
+            landmarks.push_back(next_landmark);
+            std::vector<size_t> hops(vertex_count, NOT_REACHED);
+            std::deque<VertexId> queue = {next_landmark};
+            hops[next_landmark] = 0;
+            while (!queue.empty()) {
+                const VertexId vertex = queue.front();
+                queue.pop_front();
+                auto visit = [&](VertexId next_vertex) {
+                    if (hops[next_vertex] == NOT_REACHED) {
+                        hops[next_vertex] = hops[vertex] + 1;
+                        queue.push_back(next_vertex);
+                    }
+                };
+                for (const auto& arc : graph_.GetOutgoingArcs(vertex)) {
+                    visit(arc.vertex);
+                }
+                for (const auto& arc : graph_.GetIngoingArcs(vertex)) {
+                    visit(arc.vertex);
+                }
+            }
+            // Only the component of the first landmark is covered: stops served by no bus would
+            // otherwise take landmarks of their own.
+            size_t max_hops = 0;
+            for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+                hops_to_landmarks[vertex] = std::min(hops_to_landmarks[vertex], hops[vertex]);
+                if (hops_to_landmarks[vertex] != NOT_REACHED && hops_to_landmarks[vertex] > max_hops) {
+                    max_hops = hops_to_landmarks[vertex];
+                    next_landmark = vertex;
+                }
+            }
+            if (max_hops == 0) {
+                break;
+            }
+        }
+        return landmarks;
+    }
+
+    void ComputeDistances(VertexId landmark, bool to_landmark, Weight* table, size_t stride) const {
+        std::vector<Weight> weights(graph_.GetVertexCount(), NO_PATH);
+        Queue queue;
+        weights[landmark] = ZERO_WEIGHT;
+        queue.push({ZERO_WEIGHT, landmark});
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (weights[vertex] < weight) {
+                continue;
+            }
+            const auto arcs = to_landmark ? graph_.GetIngoingArcs(vertex) : graph_.GetOutgoingArcs(vertex);
+            for (const auto& arc : arcs) {
+                const Weight candidate_weight = weight + arc.weight;
+                if (candidate_weight < weights[arc.vertex]) {
+                    weights[arc.vertex] = candidate_weight;
+                    queue.push({candidate_weight, arc.vertex});
+                }
+            }
+        }
+        for (VertexId vertex = 0; vertex < weights.size(); ++vertex) {
+            table[vertex * stride] = weights[vertex];
+        }
+    }
+
+    // Lower bound of the distance from vertex to the target, infinity when the target is unreachable.
+    Weight GetPotential(VertexId vertex, const Weight* target_to, const Weight* target_from) const {
+        const size_t landmark_count = tables_.landmarks.size();
+        const Weight* vertex_to = tables_.to_landmarks.data() + vertex * landmark_count;
+        const Weight* vertex_from = tables_.from_landmarks.data() + vertex * landmark_count;
+        Weight potential = ZERO_WEIGHT;
+        for (size_t i = 0; i < landmark_count; ++i) {
+            if (target_to[i] != NO_PATH) {
+                potential = std::max(potential, vertex_to[i] - target_to[i]);
+            }
+            if (vertex_from[i] != NO_PATH) {
+                potential = std::max(potential, target_from[i] - vertex_from[i]);
+            }
+        }
+        return potential;
+    }
+
+    const Graph& graph_;
+    LandmarkTables tables_;
+};
+
+template <typename Weight>
+AltRouter<Weight>::AltRouter(const Graph& graph, size_t landmark_count, size_t thread_count)
+    : graph_(graph)
+{
+    CheckGraph();
+    tables_.landmarks = SelectLandmarks(landmark_count);
+    const size_t count = tables_.landmarks.size();
+    tables_.to_landmarks.assign(graph.GetVertexCount() * count, NO_PATH);
+    tables_.from_landmarks.assign(graph.GetVertexCount() * count, NO_PATH);
+    parallel::ParallelFor(2 * count, thread_count, [this, count](size_t task) {
+        const size_t index = task / 2;
+        const bool to_landmark = task % 2 == 0;
+        Weight* table = (to_landmark ? tables_.to_landmarks : tables_.from_landmarks).data() + index;
+        ComputeDistances(tables_.landmarks[index], to_landmark, table, count);
+    });
+}
+
+template <typename Weight>
+AltRouter<Weight>::AltRouter(const Graph& graph, LandmarkTables tables)
+    : graph_(graph)
+    , tables_(std::move(tables))
+{
+    CheckGraph();
+    const size_t size = graph.GetVertexCount() * tables_.landmarks.size();
+    if (tables_.to_landmarks.size() != size || tables_.from_landmarks.size() != size) {
+        throw std::invalid_argument("Landmark tables do not match the graph");
+    }
+}
+
+template <typename Weight>
+std::optional<typename AltRouter<Weight>::RouteInfo> AltRouter<Weight>::BuildRoute(VertexId from, VertexId to,
+                                                                                   SearchStats* stats) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    const size_t landmark_count = tables_.landmarks.size();
+    const Weight* target_to = tables_.to_landmarks.data() + to * landmark_count;
+    const Weight* target_from = tables_.from_landmarks.data() + to * landmark_count;
+
+    std::vector<Weight> weights(vertex_count, NO_PATH);
+    std::vector<Weight> potentials(vertex_count, NO_PATH);
+    std::vector<std::optional<EdgeId>> prev_edges(vertex_count);
+    size_t settled_vertices = 0;
+
+    Queue queue;
+    weights[from] = ZERO_WEIGHT;
+    potentials[from] = GetPotential(from, target_to, target_from);
+    if (potentials[from] != NO_PATH) {
+        queue.push({potentials[from], from});
+    }
+    while (!queue.empty()) {
+        const auto [key, vertex] = queue.top();
+        queue.pop();
+        if (weights[vertex] + potentials[vertex] < key) {
+            continue;
+        }
+        ++settled_vertices;
+        if (vertex == to) {
+            break;
+        }
+        for (const auto& arc : graph_.GetOutgoingArcs(vertex)) {
+            const Weight candidate_weight = weights[vertex] + arc.weight;
+            if (!(candidate_weight < weights[arc.vertex])) {
+                continue;
+            }
+            if (weights[arc.vertex] == NO_PATH) {
+                potentials[arc.vertex] = GetPotential(arc.vertex, target_to, target_from);
+            }
+            if (potentials[arc.vertex] == NO_PATH) {
+                continue;
+            }
+            weights[arc.vertex] = candidate_weight;
+            prev_edges[arc.vertex] = arc.edge_id;
+            queue.push({candidate_weight + potentials[arc.vertex], arc.vertex});
+        }
+    }
+    if (stats) {
+        stats->settled_vertices = settled_vertices;
+    }
+
+    if (weights[to] == NO_PATH) {
+        return std::nullopt;
+    }
+    std::vector<EdgeId> edges;
+    for (std::optional<EdgeId> edge_id = prev_edges[to]; edge_id; edge_id = prev_edges[graph_.GetEdge(*edge_id).from]) {
+        edges.push_back(*edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return RouteInfo{weights[to], std::move(edges)};
+}
+
+}  // namespace graph
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Searches forward from the source over outgoing edges and backward from the target over
+// ingoing ones, always advancing the side with fewer queued vertices. Stops once the two smallest
+// keys together are not less than the best path through a vertex reached from both sides, and
+// skips the relaxations that cannot beat that path.
+template <typename Weight>
+class BidirectionalDijkstraRouter {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using RouteInfo = typename Router<Weight>::RouteInfo;
+
+    explicit BidirectionalDijkstraRouter(const Graph& graph);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+private:
+    static constexpr size_t FORWARD = 0;
+    static constexpr size_t BACKWARD = 1;
+
+    struct Label {
+        std::optional<Weight> weight;
+        // The edge leading to the vertex in the forward search, out of it in the backward one.
+        std::optional<EdgeId> edge;
+        bool settled = false;
+    };
+    // The labels of both searches side by side, a relaxation reads the other one to meet it.
+    struct VertexData {
+        Label labels[2];
+    };
+    using QueueItem = std::pair<Weight, VertexId>;
+    using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    const Graph& graph_;
+};
+
+template <typename Weight>
+BidirectionalDijkstraRouter<Weight>::BidirectionalDijkstraRouter(const Graph& graph)
+    : graph_(graph)
+{
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename BidirectionalDijkstraRouter<Weight>::RouteInfo>
+BidirectionalDijkstraRouter<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    std::vector<VertexData> vertices_data(vertex_count);
+    Queue queues[2];
+    vertices_data[from].labels[FORWARD].weight = ZERO_WEIGHT;
+    queues[FORWARD].push({ZERO_WEIGHT, from});
+    vertices_data[to].labels[BACKWARD].weight = ZERO_WEIGHT;
+    queues[BACKWARD].push({ZERO_WEIGHT, to});
+
+    std::optional<Weight> best_weight;
+    VertexId meeting_vertex = from;
+    if (from == to) {
+        best_weight = ZERO_WEIGHT;
+    }
+
+    while (true) {
+        for (size_t side : {FORWARD, BACKWARD}) {
+            Queue& queue = queues[side];
+            while (!queue.empty() && vertices_data[queue.top().second].labels[side].settled) {
+                queue.pop();
+            }
+        }
+        if (queues[FORWARD].empty() || queues[BACKWARD].empty()) {
+            break;
+        }
+        if (best_weight && !(queues[FORWARD].top().first + queues[BACKWARD].top().first < *best_weight)) {
+            break;
+        }
+        const size_t side = queues[FORWARD].size() <= queues[BACKWARD].size() ? FORWARD : BACKWARD;
+        const size_t other_side = side == FORWARD ? BACKWARD : FORWARD;
+        const auto [weight, vertex] = queues[side].top();
+        queues[side].pop();
+        vertices_data[vertex].labels[side].settled = true;
+        // Whatever the other side has not settled yet is at least this far from its end.
+        const Weight other_min_weight = queues[other_side].top().first;
+
+        const auto arcs = side == FORWARD ? graph_.GetOutgoingArcs(vertex) : graph_.GetIngoingArcs(vertex);
+        for (const auto& arc : arcs) {
+            Label& next_label = vertices_data[arc.vertex].labels[side];
+            const Weight candidate_weight = weight + arc.weight;
+            if (next_label.settled || (next_label.weight && !(candidate_weight < *next_label.weight))) {
+                continue;
+            }
+            const Label& other_label = vertices_data[arc.vertex].labels[other_side];
+            if (best_weight
+                && !(candidate_weight + (other_label.settled ? *other_label.weight : other_min_weight) < *best_weight)) {
+                continue;
+            }
+            next_label.weight = candidate_weight;
+            next_label.edge = arc.edge_id;
+            queues[side].push({candidate_weight, arc.vertex});
+            // Every pair of labels of a vertex is compared when the later of the two is set.
+            if (other_label.weight && (!best_weight || candidate_weight + *other_label.weight < *best_weight)) {
+                best_weight = candidate_weight + *other_label.weight;
+                meeting_vertex = arc.vertex;
+            }
+        }
+    }
+
+    if (!best_weight) {
+        return std::nullopt;
+    }
+    std::vector<EdgeId> edges;
+    for (std::optional<EdgeId> edge_id = vertices_data[meeting_vertex].labels[FORWARD].edge;
+         edge_id;
+         edge_id = vertices_data[graph_.GetEdge(*edge_id).from].labels[FORWARD].edge)
+    {
+        edges.push_back(*edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+    for (std::optional<EdgeId> edge_id = vertices_data[meeting_vertex].labels[BACKWARD].edge;
+         edge_id;
+         edge_id = vertices_data[graph_.GetEdge(*edge_id).to].labels[BACKWARD].edge)
+    {
+        edges.push_back(*edge_id);
+    }
+
+    return RouteInfo{*best_weight, std::move(edges)};
+}
+
+}  // namespace graph
@@ -0,0 +1,203 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+struct ShortestPathCacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t evictions = 0;
+    size_t cached_trees = 0;
+    size_t used_bytes = 0;
+    size_t budget_bytes = 0;
+};
+
+// Computes the whole shortest path tree of a source on its first query and keeps the most
+// recently used trees while they fit into the byte budget. At least one tree is always kept.
+template <typename Weight>
+class CachingRouter {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+    static_assert(std::numeric_limits<Weight>::has_infinity, "CachingRouter stores unreachable vertices as infinity");
+
+public:
+    using RouteInfo = typename Router<Weight>::RouteInfo;
+
+    CachingRouter(const Graph& graph, size_t budget_bytes);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    ShortestPathCacheStats GetCacheStats() const;
+
+    // The cached trees with their entries, not the trees evicted while a query still holds them.
+    memory_usage::Usage GetMemoryUsage() const;
+
+private:
+    using PrevEdge = uint32_t;
+    static constexpr PrevEdge NO_PREV_EDGE = std::numeric_limits<PrevEdge>::max();
+
+    struct ShortestPathTree {
+        std::vector<Weight> weights;
+        std::vector<PrevEdge> prev_edges;
+    };
+
+    struct CacheEntry {
+        std::shared_ptr<const ShortestPathTree> tree;
+        std::list<VertexId>::iterator position;
+    };
+
+    struct Cache {
+        std::mutex mutex;
+        std::list<VertexId> lru_order;
+        std::unordered_map<VertexId, CacheEntry> entries;
+        ShortestPathCacheStats stats;
+    };
+
+    using QueueItem = std::pair<Weight, VertexId>;
+    using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+
+    size_t GetTreeBytes() const {
+        return graph_.GetVertexCount() * (sizeof(Weight) + sizeof(PrevEdge));
+    }
+
+    std::shared_ptr<const ShortestPathTree> BuildTree(VertexId from) const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        auto tree = std::make_shared<ShortestPathTree>();
+        tree->weights.assign(vertex_count, std::numeric_limits<Weight>::infinity());
+        tree->prev_edges.assign(vertex_count, NO_PREV_EDGE);
+        tree->weights[from] = ZERO_WEIGHT;
+
+        Queue queue;
+        queue.push({ZERO_WEIGHT, from});
+        while (!queue.empty()) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (tree->weights[vertex] < weight) {
+                continue;
+            }
+            for (const auto& arc : graph_.GetOutgoingArcs(vertex)) {
+                const Weight candidate_weight = weight + arc.weight;
+                if (candidate_weight < tree->weights[arc.vertex]) {
+                    tree->weights[arc.vertex] = candidate_weight;
+                    tree->prev_edges[arc.vertex] = static_cast<PrevEdge>(arc.edge_id);
+                    queue.push({candidate_weight, arc.vertex});
+                }
+            }
+        }
+        return tree;
+    }
+
+    std::shared_ptr<const ShortestPathTree> GetTree(VertexId from) const {
+        Cache& cache = *cache_;
+        {
+            std::lock_guard guard(cache.mutex);
+            if (const auto it = cache.entries.find(from); it != cache.entries.end()) {
+                ++cache.stats.hits;
+                cache.lru_order.splice(cache.lru_order.begin(), cache.lru_order, it->second.position);
+                return it->second.tree;
+            }
+            ++cache.stats.misses;
+        }
+
+        auto tree = BuildTree(from);
+
+        std::lock_guard guard(cache.mutex);
+        if (cache.entries.count(from)) {
+            return tree;
+        }
+        cache.lru_order.push_front(from);
+        cache.entries[from] = {tree, cache.lru_order.begin()};
+        cache.stats.used_bytes += GetTreeBytes();
+        while (cache.stats.used_bytes > cache.stats.budget_bytes && cache.entries.size() > 1) {
+            cache.entries.erase(cache.lru_order.back());
+            cache.lru_order.pop_back();
+            cache.stats.used_bytes -= GetTreeBytes();
+            ++cache.stats.evictions;
+        }
+        return tree;
+    }
+
+    static constexpr Weight ZERO_WEIGHT{};
+    const Graph& graph_;
+    std::unique_ptr<Cache> cache_;
+};
+
+template <typename Weight>
+CachingRouter<Weight>::CachingRouter(const Graph& graph, size_t budget_bytes)
+    : graph_(graph)
+    , cache_(std::make_unique<Cache>())
+{
+    if (graph.GetEdgeCount() >= NO_PREV_EDGE) {
+        throw std::length_error("Too many edges for 32-bit edge ids");
+    }
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+    cache_->stats.budget_bytes = budget_bytes;
+}
+
+template <typename Weight>
+std::optional<typename CachingRouter<Weight>::RouteInfo> CachingRouter<Weight>::BuildRoute(VertexId from,
+                                                                                           VertexId to) const {
+    if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    const auto tree = GetTree(from);
+    if (tree->weights[to] == std::numeric_limits<Weight>::infinity()) {
+        return std::nullopt;
+    }
+    std::vector<EdgeId> edges;
+    for (PrevEdge edge_id = tree->prev_edges[to];
+         edge_id != NO_PREV_EDGE;
+         edge_id = tree->prev_edges[graph_.GetEdge(edge_id).from])
+    {
+        edges.push_back(edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return RouteInfo{tree->weights[to], std::move(edges)};
+}
+
+template <typename Weight>
+ShortestPathCacheStats CachingRouter<Weight>::GetCacheStats() const {
+    std::lock_guard guard(cache_->mutex);
+    ShortestPathCacheStats stats = cache_->stats;
+    stats.cached_trees = cache_->entries.size();
+    return stats;
+}
+
+template <typename Weight>
+memory_usage::Usage CachingRouter<Weight>::GetMemoryUsage() const {
+    // make_shared puts the tree next to its two reference counters, a list node holds two pointers.
+    constexpr size_t SHARED_COUNTERS_SIZE = 16;
+    std::lock_guard guard(cache_->mutex);
+    memory_usage::Usage usage = memory_usage::Measure(cache_->entries);
+    usage.AddAllocations(2 * sizeof(void*) + sizeof(VertexId), cache_->lru_order.size());
+    for (const auto& [vertex, entry] : cache_->entries) {
+        usage.AddAllocation(sizeof(ShortestPathTree) + SHARED_COUNTERS_SIZE);
+        usage += memory_usage::Measure(entry.tree->weights);
+        usage += memory_usage::Measure(entry.tree->prev_edges);
+    }
+    return usage;
+}
+
+}  // namespace graph
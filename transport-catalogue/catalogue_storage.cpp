@@ -0,0 +1,362 @@
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "catalogue_storage.h"
+#include "temp_file.h"
+
+namespace catalogue_storage {
+namespace detail {
+
+constexpr char MAGIC[8] = {'T', 'C', 'B', 'A', 'S', 'E', '0', '0'};
+constexpr uint32_t VERSION = 1;
+
+constexpr uint32_t HAS_ROUTING = 1;
+constexpr uint32_t HAS_RENDER = 2;
+
+// A string in the names blob.
+struct NameRef {
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct RoutingRecord {
+    double bus_velocity;
+    int32_t bus_wait_time;
+    uint32_t router_type;
+    uint64_t thread_count;
+    uint64_t cache_budget_bytes;
+    uint64_t landmark_count;
+    uint32_t vertex_order;
+    uint32_t float_weights;
+    uint32_t query_stats;
+    NameRef table_file;
+};
+
+// The colors are a section of their own: the underlayer color and then the palette.
+struct RenderRecord {
+    double width;
+    double height;
+    double padding;
+    double line_width;
+    double stop_radius;
+    double bus_label_offset_x;
+    double bus_label_offset_y;
+    double stop_label_offset_x;
+    double stop_label_offset_y;
+    double underlayer_width;
+    int32_t bus_label_font_size;
+    int32_t stop_label_font_size;
+};
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t stop_count;
+    uint64_t distance_count;
+    uint64_t bus_count;
+    uint64_t route_size;
+    uint64_t color_count;
+    uint64_t names_size;
+    RoutingRecord routing;
+    RenderRecord render;
+};
+
+struct StopRecord {
+    double lat;
+    double lng;
+    NameRef name;
+};
+
+struct DistanceRecord {
+    uint32_t from;
+    uint32_t to;
+    int32_t distance;
+};
+
+// The routes follow one another in the route section, in the order of buses.
+struct BusRecord {
+    NameRef name;
+    uint32_t route_size;
+    uint32_t ring;
+};
+
+// kind is the index of the alternative in svg::Color.
+struct ColorRecord {
+    uint32_t kind;
+    uint8_t red;
+    uint8_t green;
+    uint8_t blue;
+    double opacity;
+    NameRef name;
+};
+
+size_t AlignUp(size_t size) {
+    return (size + 7) / 8 * 8;
+}
+
+// Sections follow the header in this order, each starts at a multiple of 8.
+struct Layout {
+    size_t stops_offset;
+    size_t distances_offset;
+    size_t buses_offset;
+    size_t route_offset;
+    size_t colors_offset;
+    size_t names_offset;
+    size_t file_size;
+};
+
+Layout GetLayout(const FileHeader& header) {
+    Layout layout;
+    layout.stops_offset = sizeof(FileHeader);
+    layout.distances_offset = layout.stops_offset + AlignUp(header.stop_count * sizeof(StopRecord));
+    layout.buses_offset = layout.distances_offset + AlignUp(header.distance_count * sizeof(DistanceRecord));
+    layout.route_offset = layout.buses_offset + AlignUp(header.bus_count * sizeof(BusRecord));
+    layout.colors_offset = layout.route_offset + AlignUp(header.route_size * sizeof(uint32_t));
+    layout.names_offset = layout.colors_offset + AlignUp(header.color_count * sizeof(ColorRecord));
+    layout.file_size = layout.names_offset + AlignUp(header.names_size);
+    return layout;
+}
+
+class NamesWriter {
+public:
+    NameRef Add(std::string_view name) {
+        const NameRef result{static_cast<uint32_t>(names_.size()), static_cast<uint32_t>(name.size())};
+        names_.insert(names_.end(), name.begin(), name.end());
+        return result;
+    }
+
+    const std::vector<char>& GetNames() const {
+        return names_;
+    }
+
+private:
+    std::vector<char> names_;
+};
+
+ColorRecord MakeColorRecord(const svg::Color& color, NamesWriter& names) {
+    ColorRecord record{};
+    record.kind = static_cast<uint32_t>(color.index());
+    if (const auto* name = std::get_if<std::string>(&color)) {
+        record.name = names.Add(*name);
+    }
+    else if (const auto* rgb = std::get_if<svg::Rgb>(&color)) {
+        record.red = rgb->red;
+        record.green = rgb->green;
+        record.blue = rgb->blue;
+    }
+    else if (const auto* rgba = std::get_if<svg::Rgba>(&color)) {
+        record.red = rgba->red;
+        record.green = rgba->green;
+        record.blue = rgba->blue;
+        record.opacity = rgba->opacity;
+    }
+    return record;
+}
+
+template <typename T>
+void WriteSection(std::ostream& output, const std::vector<T>& values) {
+    const size_t size = values.size() * sizeof(T);
+    static constexpr char PADDING[8] = {};
+    output.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(size));
+    output.write(PADDING, static_cast<std::streamsize>(AlignUp(size) - size));
+}
+
+[[noreturn]] void ThrowInvalid(const std::string& path) {
+    using namespace std::literals::string_literals;
+    throw std::runtime_error("Invalid catalogue base file "s + path);
+}
+
+} // detail
+
+void SaveBase(const std::string& path, const transport_catalogue::TransportCatalogue& catalogue,
+              const Settings& settings) {
+    using namespace detail;
+    using namespace std::literals::string_literals;
+    NamesWriter names;
+    std::vector<StopRecord> stops;
+    stops.reserve(catalogue.GetAllStops().size());
+    for (const Stop& stop : catalogue.GetAllStops()) {
+        stops.push_back({stop.coordinates.lat, stop.coordinates.lng, names.Add(stop.name)});
+    }
+    std::vector<DistanceRecord> distances;
+    for (const RoadDistance& distance : catalogue.GetRoadDistances()) {
+        distances.push_back({distance.from, distance.to, distance.distance});
+    }
+    std::vector<BusRecord> buses;
+    std::vector<uint32_t> route;
+    for (const Bus& bus : catalogue.GetAllBuses()) {
+        buses.push_back({names.Add(bus.name), static_cast<uint32_t>(bus.route.size()), bus.ring ? 1u : 0u});
+        for (const Stop* stop : bus.route) {
+            route.push_back(stop->id);
+        }
+    }
+
+    FileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    std::vector<ColorRecord> colors;
+    if (settings.routing) {
+        const RoutingSettings& routing = *settings.routing;
+        header.flags |= HAS_ROUTING;
+        header.routing.bus_velocity = routing.bus_velocity;
+        header.routing.bus_wait_time = routing.bus_wait_time;
+        header.routing.router_type = static_cast<uint32_t>(routing.router.type);
+        header.routing.thread_count = routing.router.thread_count;
+        header.routing.cache_budget_bytes = routing.router.cache_budget_bytes;
+        header.routing.landmark_count = routing.router.landmark_count;
+        header.routing.vertex_order = static_cast<uint32_t>(routing.router.vertex_order);
+        header.routing.float_weights = routing.router.float_weights;
+        header.routing.query_stats = routing.router.query_stats;
+        header.routing.table_file = names.Add(routing.router.table_file);
+    }
+    if (settings.render) {
+        const map_renderer::RenderSettings& render = *settings.render;
+        header.flags |= HAS_RENDER;
+        header.render = {render.width, render.height, render.padding, render.line_width, render.stop_radius,
+                         render.bus_label_offset.x, render.bus_label_offset.y,
+                         render.stop_label_offset.x, render.stop_label_offset.y,
+                         render.underlayer_width, render.bus_label_font_size, render.stop_label_font_size};
+        colors.push_back(MakeColorRecord(render.underlayer_color, names));
+        for (const svg::Color& color : render.color_palette) {
+            colors.push_back(MakeColorRecord(color, names));
+        }
+    }
+    header.stop_count = stops.size();
+    header.distance_count = distances.size();
+    header.bus_count = buses.size();
+    header.route_size = route.size();
+    header.color_count = colors.size();
+    header.names_size = names.GetNames().size();
+
+    temp_file::WriteReplacing(path, "the catalogue base"s, [&](std::ostream& output) {
+        output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        WriteSection(output, stops);
+        WriteSection(output, distances);
+        WriteSection(output, buses);
+        WriteSection(output, route);
+        WriteSection(output, colors);
+        WriteSection(output, names.GetNames());
+    });
+}
+
+Settings LoadBase(const std::string& path, transport_catalogue::TransportCatalogue& catalogue) {
+    using namespace detail;
+    std::ifstream input(path, std::ios::binary | std::ios::ate);
+    if (!input) {
+        ThrowInvalid(path);
+    }
+    const size_t file_size = static_cast<size_t>(input.tellg());
+    if (file_size < sizeof(FileHeader)) {
+        ThrowInvalid(path);
+    }
+    // Words keep the records aligned.
+    std::vector<uint64_t> buffer(AlignUp(file_size) / sizeof(uint64_t));
+    const char* data = reinterpret_cast<const char*>(buffer.data());
+    input.seekg(0);
+    input.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(file_size));
+    FileHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (!input || std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION) {
+        ThrowInvalid(path);
+    }
+    const Layout layout = GetLayout(header);
+    if (layout.file_size != file_size) {
+        ThrowInvalid(path);
+    }
+    const std::string_view names(data + layout.names_offset, header.names_size);
+    auto get_name = [&names, &path](NameRef name) {
+        if (name.offset > names.size() || name.size > names.size() - name.offset) {
+            ThrowInvalid(path);
+        }
+        return names.substr(name.offset, name.size);
+    };
+
+    // Stop ids in the file are the ids the stops get here.
+    const auto* stops = reinterpret_cast<const StopRecord*>(data + layout.stops_offset);
+    for (size_t i = 0; i < header.stop_count; ++i) {
+        catalogue.AddStop(get_name(stops[i].name), {stops[i].lat, stops[i].lng});
+    }
+    // Both ways of every pair are in the file, so adding them in any order restores every value.
+    const auto* distances = reinterpret_cast<const DistanceRecord*>(data + layout.distances_offset);
+    for (size_t i = 0; i < header.distance_count; ++i) {
+        catalogue.AddDistances(distances[i].from, distances[i].to, distances[i].distance);
+    }
+    const auto* buses = reinterpret_cast<const BusRecord*>(data + layout.buses_offset);
+    const auto* route = reinterpret_cast<const uint32_t*>(data + layout.route_offset);
+    const uint32_t* route_end = route + header.route_size;
+    for (size_t i = 0; i < header.bus_count; ++i) {
+        if (buses[i].route_size > static_cast<size_t>(route_end - route)) {
+            ThrowInvalid(path);
+        }
+        catalogue.AddBus(get_name(buses[i].name), std::vector<StopId>(route, route + buses[i].route_size), buses[i].ring != 0);
+        route += buses[i].route_size;
+    }
+    if (route != route_end) {
+        ThrowInvalid(path);
+    }
+    catalogue.Finalize(header.flags & HAS_ROUTING ? header.routing.thread_count : 1);
+
+    Settings settings;
+    if (header.flags & HAS_ROUTING) {
+        const RoutingRecord& record = header.routing;
+        RoutingSettings routing;
+        routing.bus_velocity = record.bus_velocity;
+        routing.bus_wait_time = record.bus_wait_time;
+        routing.router.type = static_cast<transport_router::RouterType>(record.router_type);
+        routing.router.thread_count = record.thread_count;
+        routing.router.cache_budget_bytes = record.cache_budget_bytes;
+        routing.router.landmark_count = record.landmark_count;
+        routing.router.vertex_order = static_cast<transport_router::VertexOrder>(record.vertex_order);
+        routing.router.float_weights = record.float_weights != 0;
+        routing.router.query_stats = record.query_stats != 0;
+        routing.router.table_file = std::string(get_name(record.table_file));
+        settings.routing = std::move(routing);
+    }
+    if (header.flags & HAS_RENDER) {
+        const RenderRecord& record = header.render;
+        const auto* colors = reinterpret_cast<const ColorRecord*>(data + layout.colors_offset);
+        auto get_color = [&get_name, &path](const ColorRecord& color) -> svg::Color {
+            switch (color.kind) {
+            case 0:
+                return svg::NoneColor;
+            case 1:
+                return std::string(get_name(color.name));
+            case 2:
+                return svg::Rgb{color.red, color.green, color.blue};
+            case 3:
+                return svg::Rgba{color.red, color.green, color.blue, color.opacity};
+            default:
+                ThrowInvalid(path);
+            }
+        };
+        if (header.color_count == 0) {
+            ThrowInvalid(path);
+        }
+        map_renderer::RenderSettings render;
+        render.width = record.width;
+        render.height = record.height;
+        render.padding = record.padding;
+        render.line_width = record.line_width;
+        render.stop_radius = record.stop_radius;
+        render.bus_label_font_size = record.bus_label_font_size;
+        render.bus_label_offset = {record.bus_label_offset_x, record.bus_label_offset_y};
+        render.stop_label_font_size = record.stop_label_font_size;
+        render.stop_label_offset = {record.stop_label_offset_x, record.stop_label_offset_y};
+        render.underlayer_color = get_color(colors[0]);
+        render.underlayer_width = record.underlayer_width;
+        for (size_t i = 1; i < header.color_count; ++i) {
+            render.color_palette.push_back(get_color(colors[i]));
+        }
+        settings.render = std::move(render);
+    }
+    return settings;
+}
+
+} // catalogue_storage
@@ -0,0 +1,35 @@
+#pragma once
+#include <optional>
+#include <string>
+
+#include "map_renderer.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+namespace catalogue_storage {
+
+struct RoutingSettings {
+    double bus_velocity = 40.;
+    int bus_wait_time = 6;
+    transport_router::RouterSettings router;
+};
+
+// What the stat requests need besides the catalogue, nullopt for the settings the input did not have.
+struct Settings {
+    std::optional<RoutingSettings> routing;
+    std::optional<map_renderer::RenderSettings> render;
+};
+
+// A base file holds the stops, road distances and buses in flat arrays of fixed-size records, with all
+// names in one blob, and the settings next to them, in the byte order of the machine that wrote it.
+// The file is written under a name of its own next to path and renamed, so readers never see a partial
+// one and runs saving to the same path do not clash. Throws like temp_file::WriteReplacing.
+void SaveBase(const std::string& path, const transport_catalogue::TransportCatalogue& catalogue,
+              const Settings& settings);
+
+// Reads the file in one go and adds its data to an empty catalogue, which is finalized then.
+// Throws std::runtime_error for a missing file, another format version or sections of wrong sizes,
+// and std::out_of_range for stop ids out of range, like the catalogue does.
+Settings LoadBase(const std::string& path, transport_catalogue::TransportCatalogue& catalogue);
+
+} // catalogue_storage
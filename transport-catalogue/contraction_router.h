@@ -0,0 +1,383 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+template <typename Weight>
+class ContractionHierarchyRouter {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+    using ArcId = size_t;
+
+public:
+    using RouteInfo = typename Router<Weight>::RouteInfo;
+
+    explicit ContractionHierarchyRouter(const Graph& graph);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    size_t GetShortcutCount() const;
+
+    memory_usage::Usage GetMemoryUsage() const;
+
+private:
+    static constexpr ArcId NO_ARC = std::numeric_limits<ArcId>::max();
+    static constexpr size_t MAX_WITNESS_SETTLED = 500;
+
+    // Arcs [0, E) are the original edges with the same ids, the rest are shortcuts
+    // made of two other arcs.
+    struct Arc {
+        VertexId from;
+        VertexId to;
+        Weight weight;
+        ArcId first_half = NO_ARC;
+        ArcId second_half = NO_ARC;
+    };
+
+    struct Shortcut {
+        VertexId from;
+        VertexId to;
+        Weight weight;
+        ArcId first_half;
+        ArcId second_half;
+    };
+
+    struct ContractionState {
+        std::vector<std::vector<ArcId>> in_arcs;
+        std::vector<std::vector<ArcId>> out_arcs;
+        std::vector<bool> contracted;
+        std::vector<int> contracted_neighbours;
+        std::vector<std::optional<Weight>> witness_weights;
+        std::vector<std::optional<Weight>> target_out_weights;
+        std::vector<VertexId> touched;
+    };
+
+    struct SearchData {
+        std::optional<Weight> weight;
+        ArcId prev_arc = NO_ARC;
+        bool settled = false;
+    };
+
+    using QueueItem = std::pair<Weight, VertexId>;
+    using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+
+    // Bounded Dijkstra from source over the uncontracted vertices that avoids excluded. Stops as soon
+    // as every target got a path not longer than the one through excluded.
+    // Leaves tentative weights in state.witness_weights until ResetWitnesses is called.
+    void FindWitnesses(ContractionState& state, VertexId source, VertexId excluded, Weight in_weight,
+                       Weight max_weight, size_t target_count) const {
+        auto update = [&state, in_weight, &target_count](VertexId vertex, Weight weight) {
+            std::optional<Weight>& vertex_weight = state.witness_weights[vertex];
+            if (!vertex_weight) {
+                state.touched.push_back(vertex);
+            }
+            if (const auto& out_weight = state.target_out_weights[vertex]) {
+                const Weight weight_through_excluded = in_weight + *out_weight;
+                if (!(weight_through_excluded < weight)
+                    && (!vertex_weight || weight_through_excluded < *vertex_weight)) {
+                    --target_count;
+                }
+            }
+            vertex_weight = weight;
+        };
+
+        update(source, ZERO_WEIGHT);
+        Queue queue;
+        queue.push({ZERO_WEIGHT, source});
+        size_t settled_count = 0;
+        while (!queue.empty() && settled_count < MAX_WITNESS_SETTLED && target_count > 0) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (*state.witness_weights[vertex] < weight) {
+                continue;
+            }
+            if (max_weight < weight) {
+                break;
+            }
+            ++settled_count;
+            for (const ArcId arc_id : state.out_arcs[vertex]) {
+                const Arc& arc = arcs_[arc_id];
+                if (arc.to == excluded) {
+                    continue;
+                }
+                const Weight candidate_weight = weight + arc.weight;
+                const std::optional<Weight>& to_weight = state.witness_weights[arc.to];
+                if (!to_weight || candidate_weight < *to_weight) {
+                    update(arc.to, candidate_weight);
+                    queue.push({candidate_weight, arc.to});
+                }
+            }
+        }
+    }
+
+    static void ResetWitnesses(ContractionState& state) {
+        for (const VertexId vertex : state.touched) {
+            state.witness_weights[vertex].reset();
+        }
+        state.touched.clear();
+    }
+
+    std::vector<Shortcut> FindShortcuts(ContractionState& state, VertexId vertex) const {
+        std::vector<Shortcut> shortcuts;
+        const auto& in_arcs = state.in_arcs[vertex];
+        const auto& out_arcs = state.out_arcs[vertex];
+        if (in_arcs.empty() || out_arcs.empty()) {
+            return shortcuts;
+        }
+        // A target entered only through the contracted vertex cannot have a witness path.
+        Weight max_out_weight = ZERO_WEIGHT;
+        size_t target_count = 0;
+        for (const ArcId arc_id : out_arcs) {
+            const VertexId to = arcs_[arc_id].to;
+            if (state.in_arcs[to].size() > 1) {
+                max_out_weight = std::max(max_out_weight, arcs_[arc_id].weight);
+                state.target_out_weights[to] = arcs_[arc_id].weight;
+                ++target_count;
+            }
+        }
+        for (const ArcId in_arc_id : in_arcs) {
+            const VertexId from = arcs_[in_arc_id].from;
+            const Weight in_weight = arcs_[in_arc_id].weight;
+            if (target_count > 0) {
+                FindWitnesses(state, from, vertex, in_weight, in_weight + max_out_weight, target_count);
+            }
+            for (const ArcId out_arc_id : out_arcs) {
+                const VertexId to = arcs_[out_arc_id].to;
+                if (from == to) {
+                    continue;
+                }
+                const Weight weight = in_weight + arcs_[out_arc_id].weight;
+                const std::optional<Weight>& witness_weight = state.witness_weights[to];
+                if (!witness_weight || weight < *witness_weight) {
+                    shortcuts.push_back({from, to, weight, in_arc_id, out_arc_id});
+                }
+            }
+            ResetWitnesses(state);
+        }
+        for (const ArcId arc_id : out_arcs) {
+            state.target_out_weights[arcs_[arc_id].to].reset();
+        }
+        return shortcuts;
+    }
+
+    int64_t ComputePriority(ContractionState& state, VertexId vertex) const {
+        const int64_t shortcut_count = FindShortcuts(state, vertex).size();
+        const int64_t in_count = state.in_arcs[vertex].size();
+        const int64_t out_count = state.out_arcs[vertex].size();
+        return shortcut_count - in_count - out_count + state.contracted_neighbours[vertex];
+    }
+
+    // Keeps at most one arc, the lightest one, per ordered pair of uncontracted vertices.
+    void AddArc(ContractionState& state, ArcId arc_id) {
+        const Arc& arc = arcs_[arc_id];
+        auto& from_out_arcs = state.out_arcs[arc.from];
+        const auto it = std::find_if(from_out_arcs.begin(), from_out_arcs.end(), [this, &arc](ArcId other_id) {
+            return arcs_[other_id].to == arc.to;
+        });
+        if (it != from_out_arcs.end()) {
+            if (!(arc.weight < arcs_[*it].weight)) {
+                return;
+            }
+            auto& to_in_arcs = state.in_arcs[arc.to];
+            to_in_arcs.erase(std::find(to_in_arcs.begin(), to_in_arcs.end(), *it));
+            from_out_arcs.erase(it);
+        }
+        from_out_arcs.push_back(arc_id);
+        state.in_arcs[arc.to].push_back(arc_id);
+    }
+
+    // The arcs of a contracted vertex lead to higher ranked vertices only, so they form
+    // its part of the upward and downward search graphs.
+    void ContractVertex(ContractionState& state, VertexId vertex) {
+        const std::vector<Shortcut> shortcuts = FindShortcuts(state, vertex);
+        state.contracted[vertex] = true;
+        for (const ArcId arc_id : state.in_arcs[vertex]) {
+            const VertexId from = arcs_[arc_id].from;
+            auto& from_out_arcs = state.out_arcs[from];
+            from_out_arcs.erase(std::find(from_out_arcs.begin(), from_out_arcs.end(), arc_id));
+            ++state.contracted_neighbours[from];
+        }
+        for (const ArcId arc_id : state.out_arcs[vertex]) {
+            const VertexId to = arcs_[arc_id].to;
+            auto& to_in_arcs = state.in_arcs[to];
+            to_in_arcs.erase(std::find(to_in_arcs.begin(), to_in_arcs.end(), arc_id));
+            ++state.contracted_neighbours[to];
+        }
+        down_arcs_[vertex] = std::move(state.in_arcs[vertex]);
+        up_arcs_[vertex] = std::move(state.out_arcs[vertex]);
+
+        for (const Shortcut& shortcut : shortcuts) {
+            arcs_.push_back({shortcut.from, shortcut.to, shortcut.weight, shortcut.first_half, shortcut.second_half});
+            AddArc(state, arcs_.size() - 1);
+        }
+    }
+
+    void UnpackArc(ArcId arc_id, std::vector<EdgeId>& edges) const {
+        std::vector<ArcId> stack{arc_id};
+        while (!stack.empty()) {
+            const Arc& arc = arcs_[stack.back()];
+            const ArcId current = stack.back();
+            stack.pop_back();
+            if (arc.first_half == NO_ARC) {
+                edges.push_back(current);
+            }
+            else {
+                stack.push_back(arc.second_half);
+                stack.push_back(arc.first_half);
+            }
+        }
+    }
+
+    static constexpr Weight ZERO_WEIGHT{};
+    std::vector<Arc> arcs_;
+    size_t edge_count_ = 0;
+    std::vector<std::vector<ArcId>> up_arcs_;
+    std::vector<std::vector<ArcId>> down_arcs_;
+};
+
+template <typename Weight>
+ContractionHierarchyRouter<Weight>::ContractionHierarchyRouter(const Graph& graph)
+    : edge_count_(graph.GetEdgeCount())
+    , up_arcs_(graph.GetVertexCount())
+    , down_arcs_(graph.GetVertexCount())
+{
+    const size_t vertex_count = graph.GetVertexCount();
+    ContractionState state{std::vector<std::vector<ArcId>>(vertex_count),
+                           std::vector<std::vector<ArcId>>(vertex_count),
+                           std::vector<bool>(vertex_count, false),
+                           std::vector<int>(vertex_count, 0),
+                           std::vector<std::optional<Weight>>(vertex_count),
+                           std::vector<std::optional<Weight>>(vertex_count),
+                           {}};
+    arcs_.reserve(edge_count_);
+    for (EdgeId edge_id = 0; edge_id < edge_count_; ++edge_id) {
+        const auto& edge = graph.GetEdge(edge_id);
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+        arcs_.push_back({edge.from, edge.to, edge.weight});
+        if (edge.from != edge.to) {
+            AddArc(state, edge_id);
+        }
+    }
+
+    using PriorityItem = std::pair<int64_t, VertexId>;
+    std::priority_queue<PriorityItem, std::vector<PriorityItem>, std::greater<PriorityItem>> order;
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        order.push({ComputePriority(state, vertex), vertex});
+    }
+
+    while (!order.empty()) {
+        const VertexId vertex = order.top().second;
+        order.pop();
+        const int64_t priority = ComputePriority(state, vertex);
+        if (!order.empty() && priority > order.top().first) {
+            order.push({priority, vertex});
+            continue;
+        }
+        ContractVertex(state, vertex);
+    }
+}
+
+template <typename Weight>
+std::optional<typename ContractionHierarchyRouter<Weight>::RouteInfo>
+ContractionHierarchyRouter<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    const size_t vertex_count = up_arcs_.size();
+    std::vector<SearchData> forward(vertex_count);
+    std::vector<SearchData> backward(vertex_count);
+    forward.at(from).weight = ZERO_WEIGHT;
+    backward.at(to).weight = ZERO_WEIGHT;
+
+    Queue forward_queue;
+    Queue backward_queue;
+    forward_queue.push({ZERO_WEIGHT, from});
+    backward_queue.push({ZERO_WEIGHT, to});
+
+    std::optional<Weight> best_weight;
+    VertexId meeting_vertex = from;
+
+    auto step = [&](Queue& queue, std::vector<SearchData>& own, const std::vector<SearchData>& other,
+                    const std::vector<std::vector<ArcId>>& arcs, bool is_forward) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        SearchData& vertex_data = own[vertex];
+        if (vertex_data.settled) {
+            return;
+        }
+        vertex_data.settled = true;
+        if (other[vertex].weight && (!best_weight || weight + *other[vertex].weight < *best_weight)) {
+            best_weight = weight + *other[vertex].weight;
+            meeting_vertex = vertex;
+        }
+        for (const ArcId arc_id : arcs[vertex]) {
+            const Arc& arc = arcs_[arc_id];
+            const VertexId next = is_forward ? arc.to : arc.from;
+            SearchData& next_data = own[next];
+            const Weight candidate_weight = weight + arc.weight;
+            if (!next_data.settled && (!next_data.weight || candidate_weight < *next_data.weight)) {
+                next_data.weight = candidate_weight;
+                next_data.prev_arc = arc_id;
+                queue.push({candidate_weight, next});
+            }
+        }
+    };
+
+    auto is_done = [&best_weight](const Queue& queue) {
+        return queue.empty() || (best_weight && !(queue.top().first < *best_weight));
+    };
+
+    while (!is_done(forward_queue) || !is_done(backward_queue)) {
+        if (!is_done(forward_queue)) {
+            step(forward_queue, forward, backward, up_arcs_, true);
+        }
+        if (!is_done(backward_queue)) {
+            step(backward_queue, backward, forward, down_arcs_, false);
+        }
+    }
+
+    if (!best_weight) {
+        return std::nullopt;
+    }
+
+    std::vector<ArcId> forward_arcs;
+    for (ArcId arc_id = forward[meeting_vertex].prev_arc; arc_id != NO_ARC; arc_id = forward[arcs_[arc_id].from].prev_arc) {
+        forward_arcs.push_back(arc_id);
+    }
+    std::reverse(forward_arcs.begin(), forward_arcs.end());
+    for (ArcId arc_id = backward[meeting_vertex].prev_arc; arc_id != NO_ARC; arc_id = backward[arcs_[arc_id].to].prev_arc) {
+        forward_arcs.push_back(arc_id);
+    }
+
+    std::vector<EdgeId> edges;
+    for (const ArcId arc_id : forward_arcs) {
+        UnpackArc(arc_id, edges);
+    }
+    return RouteInfo{*best_weight, std::move(edges)};
+}
+
+template <typename Weight>
+size_t ContractionHierarchyRouter<Weight>::GetShortcutCount() const {
+    return arcs_.size() - edge_count_;
+}
+
+template <typename Weight>
+memory_usage::Usage ContractionHierarchyRouter<Weight>::GetMemoryUsage() const {
+    memory_usage::Usage usage = memory_usage::Measure(arcs_);
+    usage += memory_usage::Measure(up_arcs_);
+    usage += memory_usage::Measure(down_arcs_);
+    return usage;
+}
+
+}  // namespace graph
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+template <typename Weight>
+class DijkstraRouter {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using RouteInfo = typename Router<Weight>::RouteInfo;
+
+    explicit DijkstraRouter(const Graph& graph);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to, SearchStats* stats = nullptr) const;
+
+private:
+    struct VertexData {
+        std::optional<Weight> weight;
+        std::optional<EdgeId> prev_edge;
+        bool settled = false;
+    };
+    using QueueItem = std::pair<Weight, VertexId>;
+    using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    const Graph& graph_;
+};
+
+template <typename Weight>
+DijkstraRouter<Weight>::DijkstraRouter(const Graph& graph)
+    : graph_(graph)
+{
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::BuildRoute(VertexId from,
+                                                                                             VertexId to,
+                                                                                             SearchStats* stats) const {
+    std::vector<VertexData> vertices_data(graph_.GetVertexCount());
+    vertices_data.at(from).weight = ZERO_WEIGHT;
+    vertices_data.at(to);
+
+    size_t settled_vertices = 0;
+    Queue queue;
+    queue.push({ZERO_WEIGHT, from});
+    while (!queue.empty()) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        VertexData& vertex_data = vertices_data[vertex];
+        if (vertex_data.settled) {
+            continue;
+        }
+        vertex_data.settled = true;
+        ++settled_vertices;
+        if (vertex == to) {
+            break;
+        }
+        for (const auto& arc : graph_.GetOutgoingArcs(vertex)) {
+            VertexData& next_data = vertices_data[arc.vertex];
+            const Weight candidate_weight = weight + arc.weight;
+            if (!next_data.settled && (!next_data.weight || candidate_weight < *next_data.weight)) {
+                next_data.weight = candidate_weight;
+                next_data.prev_edge = arc.edge_id;
+                queue.push({candidate_weight, arc.vertex});
+            }
+        }
+    }
+
+    if (stats) {
+        stats->settled_vertices = settled_vertices;
+    }
+    if (!vertices_data[to].settled) {
+        return std::nullopt;
+    }
+    std::vector<EdgeId> edges;
+    for (std::optional<EdgeId> edge_id = vertices_data[to].prev_edge;
+         edge_id;
+         edge_id = vertices_data[graph_.GetEdge(*edge_id).from].prev_edge)
+    {
+        edges.push_back(*edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return RouteInfo{*vertices_data[to].weight, std::move(edges)};
+}
+
+}  // namespace graph
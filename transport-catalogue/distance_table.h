@@ -0,0 +1,88 @@
+#pragma once
+
+#include "graph.h"
+#include "parallel.h"
+
+#include <functional>
+#include <limits>
+#include <queue>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Weights of the shortest paths from every source to every target, row-major, infinity when
+// there is no path. Each source runs one Dijkstra search that stops once all targets are settled;
+// sources are spread over thread_count threads.
+template <typename Weight>
+std::vector<Weight> ComputeDistanceTable(const DirectedWeightedGraph<Weight>& graph,
+                                         const std::vector<VertexId>& sources,
+                                         const std::vector<VertexId>& targets,
+                                         size_t thread_count = 1) {
+    static_assert(std::numeric_limits<Weight>::has_infinity, "Distance table stores unreachable targets as infinity");
+    using QueueItem = std::pair<Weight, VertexId>;
+    using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<QueueItem>>;
+    constexpr Weight ZERO_WEIGHT{};
+    constexpr Weight NO_PATH = std::numeric_limits<Weight>::infinity();
+
+    const size_t vertex_count = graph.GetVertexCount();
+    for (const VertexId vertex : sources) {
+        if (vertex >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+    }
+    std::vector<bool> is_target(vertex_count, false);
+    size_t unique_target_count = 0;
+    for (const VertexId vertex : targets) {
+        if (vertex >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        if (!is_target[vertex]) {
+            is_target[vertex] = true;
+            ++unique_target_count;
+        }
+    }
+    for (EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+        if (graph.GetEdge(edge_id).weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+
+    std::vector<Weight> table(sources.size() * targets.size(), NO_PATH);
+    parallel::ParallelFor(sources.size(), thread_count, [&](size_t source_index) {
+        std::vector<Weight> weights(vertex_count, NO_PATH);
+        std::vector<bool> settled(vertex_count, false);
+        size_t targets_left = unique_target_count;
+
+        Queue queue;
+        weights[sources[source_index]] = ZERO_WEIGHT;
+        queue.push({ZERO_WEIGHT, sources[source_index]});
+        while (!queue.empty() && targets_left > 0) {
+            const auto [weight, vertex] = queue.top();
+            queue.pop();
+            if (settled[vertex]) {
+                continue;
+            }
+            settled[vertex] = true;
+            if (is_target[vertex]) {
+                --targets_left;
+            }
+            for (const auto& arc : graph.GetOutgoingArcs(vertex)) {
+                const Weight candidate_weight = weight + arc.weight;
+                if (candidate_weight < weights[arc.vertex]) {
+                    weights[arc.vertex] = candidate_weight;
+                    queue.push({candidate_weight, arc.vertex});
+                }
+            }
+        }
+
+        Weight* row = table.data() + source_index * targets.size();
+        for (size_t target_index = 0; target_index < targets.size(); ++target_index) {
+            row[target_index] = weights[targets[target_index]];
+        }
+    });
+    return table;
+}
+
+}  // namespace graph
@@ -1,19 +1,36 @@
 #pragma once
+#include <cstdint>
 #include <string>
 #include <string_view>
 #include <vector>
 
 #include "geo.h"
+#include "string_pool.h"
 
+using StopId = uint32_t;
+using BusId = uint32_t;
+
+// Names point into the catalogue's string pool, name_id is their symbol there.
+// Ids are dense and follow the order stops and buses were added in.
 struct Stop {
-	std::string name;
+	std::string_view name;
 	geo::Coordinates coordinates;
+	string_pool::SymbolId name_id;
+	StopId id;
 };
 
 struct Bus {
-	std::string name;
+	std::string_view name;
 	std::vector<Stop*> route;
 	bool ring;
+	string_pool::SymbolId name_id;
+	BusId id;
+};
+
+struct RoadDistance {
+	StopId from;
+	StopId to;
+	int distance;
 };
 
 struct EdgeInfo {
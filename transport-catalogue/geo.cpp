@@ -1,10 +1,46 @@
 #define _USE_MATH_DEFINES
 #include "geo.h"
 
+#include <algorithm>
 #include <cmath>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GEO_SSE2
+#endif
+
 namespace geo {
 
+namespace {
+
+constexpr double EARTH_RADIUS = 6371000;
+// Half the chord below which the series of the arc sine is exact to the last bit of a double.
+constexpr double SERIES_LIMIT = 0.01;
+
+static_assert(sizeof(Coordinates) == 2 * sizeof(double), "ComputeBounds loads a point as two doubles");
+
+// asin(h) = h * (1 + h^2 / 6 + 3 h^4 / 40 + 5 h^6 / 112 + 35 h^8 / 1152 + ...)
+constexpr double SERIES_1 = 1. / 6.;
+constexpr double SERIES_2 = 3. / 40.;
+constexpr double SERIES_3 = 5. / 112.;
+constexpr double SERIES_4 = 35. / 1152.;
+
+double ArcSine(double h) {
+    if (h < SERIES_LIMIT) {
+        const double s = h * h;
+        return h * ((((SERIES_4 * s + SERIES_3) * s + SERIES_2) * s + SERIES_1) * s + 1.);
+    }
+    return std::asin(std::min(h, 1.));
+}
+
+double HalfChord(double dx, double dy, double dz) {
+    return std::sqrt(dx * dx + dy * dy + dz * dz) * 0.5;
+}
+
+}
+
 bool Coordinates::operator==(const Coordinates& other) const {
     return lat == other.lat && lng == other.lng;
 }
@@ -24,4 +60,161 @@ double ComputeDistance(Coordinates from, Coordinates to) {
         * 6371000;
 }
 
-}  // namespace geo
\ No newline at end of file
+Bounds ComputeBounds(const Coordinates* begin, const Coordinates* end) {
+    if (begin == end) {
+        return {};
+    }
+#if defined(__AVX2__)
+    const double* values = &begin->lat;
+    const size_t count = end - begin;
+    // Lanes hold lat, lng, lat, lng.
+    __m256d min = _mm256_broadcast_pd(reinterpret_cast<const __m128d*>(values));
+    __m256d max = min;
+    size_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        const __m256d points = _mm256_loadu_pd(values + 2 * i);
+        min = _mm256_min_pd(min, points);
+        max = _mm256_max_pd(max, points);
+    }
+    __m128d min2 = _mm_min_pd(_mm256_castpd256_pd128(min), _mm256_extractf128_pd(min, 1));
+    __m128d max2 = _mm_max_pd(_mm256_castpd256_pd128(max), _mm256_extractf128_pd(max, 1));
+    if (i < count) {
+        const __m128d point = _mm_loadu_pd(values + 2 * i);
+        min2 = _mm_min_pd(min2, point);
+        max2 = _mm_max_pd(max2, point);
+    }
+#elif defined(GEO_SSE2)
+    const double* values = &begin->lat;
+    __m128d min2 = _mm_loadu_pd(values);
+    __m128d max2 = min2;
+    for (const Coordinates* point = begin + 1; point != end; ++point) {
+        const __m128d lat_lng = _mm_loadu_pd(&point->lat);
+        min2 = _mm_min_pd(min2, lat_lng);
+        max2 = _mm_max_pd(max2, lat_lng);
+    }
+#endif
+#if defined(__AVX2__) || defined(GEO_SSE2)
+    Bounds bounds;
+    bounds.min_lat = _mm_cvtsd_f64(min2);
+    bounds.min_lng = _mm_cvtsd_f64(_mm_unpackhi_pd(min2, min2));
+    bounds.max_lat = _mm_cvtsd_f64(max2);
+    bounds.max_lng = _mm_cvtsd_f64(_mm_unpackhi_pd(max2, max2));
+    return bounds;
+#else
+    return ComputeBounds<const Coordinates*>(begin, end);
+#endif
+}
+
+PointSet::PointSet(const std::vector<Coordinates>& points) {
+    xs_.reserve(points.size());
+    ys_.reserve(points.size());
+    zs_.reserve(points.size());
+    for (const Coordinates& point : points) {
+        Add(point);
+    }
+}
+
+void PointSet::Add(Coordinates point) {
+    const double dr = M_PI / 180.0;
+    const double cos_lat = std::cos(point.lat * dr);
+    xs_.push_back(cos_lat * std::cos(point.lng * dr));
+    ys_.push_back(cos_lat * std::sin(point.lng * dr));
+    zs_.push_back(std::sin(point.lat * dr));
+}
+
+size_t PointSet::GetSize() const {
+    return xs_.size();
+}
+
+memory_usage::Usage PointSet::GetMemoryUsage() const {
+    memory_usage::Usage usage = memory_usage::Measure(xs_);
+    usage += memory_usage::Measure(ys_);
+    usage += memory_usage::Measure(zs_);
+    return usage;
+}
+
+double PointSet::ComputePathLength(const uint32_t* indices, size_t count) const {
+    // Sum of the arc sines, the hops that take std::asin are added to the scalar part.
+    double length = 0.;
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256d c1 = _mm256_set1_pd(SERIES_1);
+    const __m256d c2 = _mm256_set1_pd(SERIES_2);
+    const __m256d c3 = _mm256_set1_pd(SERIES_3);
+    const __m256d c4 = _mm256_set1_pd(SERIES_4);
+    const __m256d one = _mm256_set1_pd(1.);
+    const __m256d half = _mm256_set1_pd(0.5);
+    const __m256d limit = _mm256_set1_pd(SERIES_LIMIT);
+    __m256d sum = _mm256_setzero_pd();
+    for (; i + 4 < count; i += 4) {
+        const __m128i from = _mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + i));
+        const __m128i to = _mm_loadu_si128(reinterpret_cast<const __m128i*>(indices + i + 1));
+        auto delta = [from, to](const std::vector<double>& axis) {
+            return _mm256_sub_pd(_mm256_i32gather_pd(axis.data(), to, 8), _mm256_i32gather_pd(axis.data(), from, 8));
+        };
+        const __m256d dx = delta(xs_);
+        const __m256d dy = delta(ys_);
+        const __m256d dz = delta(zs_);
+        const __m256d squared = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)),
+                                              _mm256_mul_pd(dz, dz));
+        const __m256d h = _mm256_mul_pd(_mm256_sqrt_pd(squared), half);
+        if (_mm256_movemask_pd(_mm256_cmp_pd(h, limit, _CMP_LT_OQ)) == 0xF) {
+            const __m256d s = _mm256_mul_pd(h, h);
+            __m256d series = _mm256_add_pd(_mm256_mul_pd(c4, s), c3);
+            series = _mm256_add_pd(_mm256_mul_pd(series, s), c2);
+            series = _mm256_add_pd(_mm256_mul_pd(series, s), c1);
+            series = _mm256_add_pd(_mm256_mul_pd(series, s), one);
+            sum = _mm256_add_pd(sum, _mm256_mul_pd(h, series));
+            continue;
+        }
+        alignas(32) double lanes[4];
+        _mm256_store_pd(lanes, h);
+        for (const double lane : lanes) {
+            length += ArcSine(lane);
+        }
+    }
+    const __m128d sum2 = _mm_add_pd(_mm256_castpd256_pd128(sum), _mm256_extractf128_pd(sum, 1));
+    length += _mm_cvtsd_f64(_mm_add_sd(sum2, _mm_unpackhi_pd(sum2, sum2)));
+#elif defined(GEO_SSE2)
+    const __m128d c1 = _mm_set1_pd(SERIES_1);
+    const __m128d c2 = _mm_set1_pd(SERIES_2);
+    const __m128d c3 = _mm_set1_pd(SERIES_3);
+    const __m128d c4 = _mm_set1_pd(SERIES_4);
+    const __m128d one = _mm_set1_pd(1.);
+    const __m128d half = _mm_set1_pd(0.5);
+    const __m128d limit = _mm_set1_pd(SERIES_LIMIT);
+    __m128d sum = _mm_setzero_pd();
+    for (; i + 2 < count; i += 2) {
+        const uint32_t a = indices[i];
+        const uint32_t b = indices[i + 1];
+        const uint32_t c = indices[i + 2];
+        auto delta = [a, b, c](const std::vector<double>& axis) {
+            return _mm_sub_pd(_mm_set_pd(axis[c], axis[b]), _mm_set_pd(axis[b], axis[a]));
+        };
+        const __m128d dx = delta(xs_);
+        const __m128d dy = delta(ys_);
+        const __m128d dz = delta(zs_);
+        const __m128d squared = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), _mm_mul_pd(dz, dz));
+        const __m128d h = _mm_mul_pd(_mm_sqrt_pd(squared), half);
+        if (_mm_movemask_pd(_mm_cmplt_pd(h, limit)) == 0x3) {
+            const __m128d s = _mm_mul_pd(h, h);
+            __m128d series = _mm_add_pd(_mm_mul_pd(c4, s), c3);
+            series = _mm_add_pd(_mm_mul_pd(series, s), c2);
+            series = _mm_add_pd(_mm_mul_pd(series, s), c1);
+            series = _mm_add_pd(_mm_mul_pd(series, s), one);
+            sum = _mm_add_pd(sum, _mm_mul_pd(h, series));
+            continue;
+        }
+        length += ArcSine(_mm_cvtsd_f64(h)) + ArcSine(_mm_cvtsd_f64(_mm_unpackhi_pd(h, h)));
+    }
+    length += _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+#endif
+    for (; i + 1 < count; ++i) {
+        const uint32_t from = indices[i];
+        const uint32_t to = indices[i + 1];
+        length += ArcSine(HalfChord(xs_[to] - xs_[from], ys_[to] - ys_[from], zs_[to] - zs_[from]));
+    }
+    return 2. * EARTH_RADIUS * length;
+}
+
+}  // namespace geo
@@ -1,5 +1,12 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#include "memory_usage.h"
+
 namespace geo {
 
 struct Coordinates {
@@ -12,4 +19,64 @@ struct Coordinates {
 
 double ComputeDistance(Coordinates from, Coordinates to);
 
+// The smallest box holding the points, all zeros when there are none.
+struct Bounds {
+    double min_lat = 0.;
+    double max_lat = 0.;
+    double min_lng = 0.;
+    double max_lng = 0.;
+};
+
+// Scans the array one point per instruction with SSE2, two with AVX2.
+Bounds ComputeBounds(const Coordinates* begin, const Coordinates* end);
+
+template <typename PointInputIt>
+Bounds ComputeBounds(PointInputIt begin, PointInputIt end) {
+    using Vector = std::vector<Coordinates>;
+    if constexpr (std::is_same_v<PointInputIt, Vector::iterator> || std::is_same_v<PointInputIt, Vector::const_iterator>) {
+        const Coordinates* data = begin == end ? nullptr : &*begin;
+        return ComputeBounds(data, data + (end - begin));
+    }
+    else {
+        Bounds bounds;
+        if (begin == end) {
+            return bounds;
+        }
+        bounds = {begin->lat, begin->lat, begin->lng, begin->lng};
+        for (; begin != end; ++begin) {
+            bounds.min_lat = begin->lat < bounds.min_lat ? begin->lat : bounds.min_lat;
+            bounds.max_lat = bounds.max_lat < begin->lat ? begin->lat : bounds.max_lat;
+            bounds.min_lng = begin->lng < bounds.min_lng ? begin->lng : bounds.min_lng;
+            bounds.max_lng = bounds.max_lng < begin->lng ? begin->lng : bounds.max_lng;
+        }
+        return bounds;
+    }
+}
+
+// Keeps the points as unit vectors, one array per axis, so that a distance needs no trigonometry:
+// it is 2 * R * asin(c / 2) for the chord c, and the arc sine is a series for hops under 127 km.
+// Paths are measured four hops at a time with AVX2, two with SSE2, one by one otherwise.
+// A hop is within 1e-8 m of the exact great-circle distance. It differs from ComputeDistance by up to
+// 0.15 m, and by under 2e-4 m for hops longer than 100 m: the arc cosine there loses precision on short hops.
+class PointSet {
+public:
+    PointSet() = default;
+    explicit PointSet(const std::vector<Coordinates>& points);
+
+    size_t GetSize() const;
+
+    memory_usage::Usage GetMemoryUsage() const;
+
+    // Appends a point, its index is the previous size.
+    void Add(Coordinates point);
+
+    // Length of the path through the points with the given indices, in order.
+    double ComputePathLength(const uint32_t* indices, size_t count) const;
+
+private:
+    std::vector<double> xs_;
+    std::vector<double> ys_;
+    std::vector<double> zs_;
+};
+
 }// namespace geo
\ No newline at end of file
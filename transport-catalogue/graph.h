@@ -1,8 +1,14 @@
 #pragma once
 
+#include "memory_usage.h"
 #include "ranges.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
 #include <cstdlib>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
 namespace graph {
@@ -17,43 +23,128 @@ struct Edge {
     Weight weight;
 };
 
+// Adjacency entry of a frozen graph: the other end of the edge and its weight next to each other.
+template <typename Weight>
+struct Arc {
+    VertexId vertex;
+    Weight weight;
+    EdgeId edge_id;
+};
+
 template <typename Weight>
 class DirectedWeightedGraph {
 private:
     using IncidenceList = std::vector<EdgeId>;
     using IncidentEdgesRange = ranges::Range<typename IncidenceList::const_iterator>;
+    using ArcsRange = ranges::Range<typename std::vector<Arc<Weight>>::const_iterator>;
 
 public:
     DirectedWeightedGraph() = default;
     explicit DirectedWeightedGraph(size_t vertex_count);
     EdgeId AddEdge(const Edge<Weight>& edge);
+    void ReserveEdges(size_t edge_count);
+    void SetEdgeWeight(EdgeId edge_id, Weight weight);
 
     size_t GetVertexCount() const;
     size_t GetEdgeCount() const;
     const Edge<Weight>& GetEdge(EdgeId edge_id) const;
     IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
+    IncidentEdgesRange GetIngoingEdges(VertexId vertex) const;
+
+    // Vertex v becomes new_ids[v], edge ids and the order of incident edges stay the same.
+    void RenumberVertices(const std::vector<VertexId>& new_ids);
+
+    // Appends vertices without edges, frozen or not.
+    void AddVertices(size_t count);
+
+    // Moves existing edges to new ends with new weights and appends new edges, frozen or not.
+    // A frozen graph rebuilds only the rows of the vertices these edges leave or enter and copies the rest.
+    // Returns the ids of the added edges.
+    std::vector<EdgeId> UpdateEdges(const std::vector<std::pair<EdgeId, Edge<Weight>>>& updated,
+                                    const std::vector<Edge<Weight>>& added);
+
+    // Packs the adjacency into compressed sparse rows and releases the per-vertex lists.
+    // Edges can't be added afterwards, weights still can be changed.
+    void Freeze();
+    bool IsFrozen() const;
+    // Only for a frozen graph; arcs of a vertex go in the order of their edge ids.
+    ArcsRange GetOutgoingArcs(VertexId vertex) const;
+    ArcsRange GetIngoingArcs(VertexId vertex) const;
+
+    // The edges with both the per-vertex lists and the compressed rows, whichever are built.
+    memory_usage::Usage GetMemoryUsage() const;
+
+    // Changes with every change of the vertices, edges or weights, and is never the same for two graphs
+    // built apart, so what is computed from a graph can tell whether the graph is still the same.
+    uint64_t GetGeneration() const;
 
 private:
+    struct CompressedRows {
+        std::vector<size_t> offsets;
+        std::vector<Arc<Weight>> arcs;
+        std::vector<EdgeId> edge_ids;
+
+        void Build(const std::vector<IncidenceList>& lists, const std::vector<Edge<Weight>>& edges, bool outgoing);
+        ArcsRange GetArcs(VertexId vertex) const;
+        IncidentEdgesRange GetEdgeIds(VertexId vertex) const;
+        void SetWeight(VertexId vertex, EdgeId edge_id, Weight weight);
+        // changed is sorted, old_rows holds the rows the changed edges were in before, if any.
+        void Update(const std::vector<EdgeId>& changed, std::vector<VertexId> old_rows,
+                    const std::vector<Edge<Weight>>& edges, bool outgoing);
+    };
+
+    static uint64_t NextGeneration() {
+        static std::atomic<uint64_t> last_generation{0};
+        return ++last_generation;
+    }
+
     std::vector<Edge<Weight>> edges_;
     std::vector<IncidenceList> incidence_lists_;
+    std::vector<IncidenceList> ingoing_lists_;
+    bool frozen_ = false;
+    CompressedRows outgoing_;
+    CompressedRows ingoing_;
+    uint64_t generation_ = NextGeneration();
 };
 
 template <typename Weight>
 DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count)
-    : incidence_lists_(vertex_count) {
+    : incidence_lists_(vertex_count)
+    , ingoing_lists_(vertex_count) {
 }
 
 template <typename Weight>
 EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
+    if (frozen_) {
+        throw std::logic_error("Can't add edges to a frozen graph");
+    }
     edges_.push_back(edge);
+    generation_ = NextGeneration();
     const EdgeId id = edges_.size() - 1;
     incidence_lists_.at(edge.from).push_back(id);
+    ingoing_lists_.at(edge.to).push_back(id);
     return id;
 }
 
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::ReserveEdges(size_t edge_count) {
+    edges_.reserve(edge_count);
+}
+
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::SetEdgeWeight(EdgeId edge_id, Weight weight) {
+    Edge<Weight>& edge = edges_.at(edge_id);
+    edge.weight = weight;
+    generation_ = NextGeneration();
+    if (frozen_) {
+        outgoing_.SetWeight(edge.from, edge_id, weight);
+        ingoing_.SetWeight(edge.to, edge_id, weight);
+    }
+}
+
 template <typename Weight>
 size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
-    return incidence_lists_.size();
+    return frozen_ ? outgoing_.offsets.size() - 1 : incidence_lists_.size();
 }
 
 template <typename Weight>
@@ -69,6 +160,355 @@ const Edge<Weight>& DirectedWeightedGraph<Weight>::GetEdge(EdgeId edge_id) const
 template <typename Weight>
 typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
 DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
+    if (frozen_) {
+        return outgoing_.GetEdgeIds(vertex);
+    }
     return ranges::AsRange(incidence_lists_.at(vertex));
 }
+
+template <typename Weight>
+typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
+DirectedWeightedGraph<Weight>::GetIngoingEdges(VertexId vertex) const {
+    if (frozen_) {
+        return ingoing_.GetEdgeIds(vertex);
+    }
+    return ranges::AsRange(ingoing_lists_.at(vertex));
+}
+
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::RenumberVertices(const std::vector<VertexId>& new_ids) {
+    const size_t vertex_count = GetVertexCount();
+    if (new_ids.size() != vertex_count) {
+        throw std::invalid_argument("New vertex ids should cover every vertex");
+    }
+    std::vector<bool> used(vertex_count, false);
+    for (const VertexId id : new_ids) {
+        if (id >= vertex_count || used[id]) {
+            throw std::invalid_argument("New vertex ids should be a permutation");
+        }
+        used[id] = true;
+    }
+    generation_ = NextGeneration();
+    const bool frozen = frozen_;
+    frozen_ = false;
+    incidence_lists_.assign(vertex_count, {});
+    ingoing_lists_.assign(vertex_count, {});
+    for (EdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+        Edge<Weight>& edge = edges_[edge_id];
+        edge.from = new_ids[edge.from];
+        edge.to = new_ids[edge.to];
+        incidence_lists_[edge.from].push_back(edge_id);
+        ingoing_lists_[edge.to].push_back(edge_id);
+    }
+    if (frozen) {
+        Freeze();
+    }
+}
+
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::AddVertices(size_t count) {
+    generation_ = NextGeneration();
+    if (frozen_) {
+        outgoing_.offsets.insert(outgoing_.offsets.end(), count, outgoing_.offsets.back());
+        ingoing_.offsets.insert(ingoing_.offsets.end(), count, ingoing_.offsets.back());
+    }
+    else {
+        incidence_lists_.resize(incidence_lists_.size() + count);
+        ingoing_lists_.resize(ingoing_lists_.size() + count);
+    }
+}
+
+template <typename Weight>
+std::vector<EdgeId> DirectedWeightedGraph<Weight>::UpdateEdges(const std::vector<std::pair<EdgeId, Edge<Weight>>>& updated,
+                                                               const std::vector<Edge<Weight>>& added) {
+    const size_t vertex_count = GetVertexCount();
+    auto check_edge = [vertex_count](const Edge<Weight>& edge) {
+        if (edge.from >= vertex_count || edge.to >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+    };
+    for (const auto& [edge_id, edge] : updated) {
+        edges_.at(edge_id);
+        check_edge(edge);
+    }
+    for (const Edge<Weight>& edge : added) {
+        check_edge(edge);
+    }
+
+    generation_ = NextGeneration();
+    std::vector<EdgeId> changed;
+    std::vector<VertexId> old_froms;
+    std::vector<VertexId> old_tos;
+    for (const auto& [edge_id, edge] : updated) {
+        Edge<Weight>& old_edge = edges_[edge_id];
+        if (frozen_) {
+            old_froms.push_back(old_edge.from);
+            old_tos.push_back(old_edge.to);
+        }
+        else {
+            auto erase = [edge_id = edge_id](IncidenceList& list) {
+                list.erase(std::lower_bound(list.begin(), list.end(), edge_id));
+            };
+            auto insert = [edge_id = edge_id](IncidenceList& list) {
+                list.insert(std::lower_bound(list.begin(), list.end(), edge_id), edge_id);
+            };
+            erase(incidence_lists_[old_edge.from]);
+            erase(ingoing_lists_[old_edge.to]);
+            insert(incidence_lists_[edge.from]);
+            insert(ingoing_lists_[edge.to]);
+        }
+        old_edge = edge;
+        changed.push_back(edge_id);
+    }
+    std::vector<EdgeId> result;
+    result.reserve(added.size());
+    for (const Edge<Weight>& edge : added) {
+        if (!frozen_) {
+            result.push_back(AddEdge(edge));
+            continue;
+        }
+        edges_.push_back(edge);
+        result.push_back(edges_.size() - 1);
+        changed.push_back(edges_.size() - 1);
+    }
+    if (frozen_) {
+        std::sort(changed.begin(), changed.end());
+        outgoing_.Update(changed, std::move(old_froms), edges_, true);
+        ingoing_.Update(changed, std::move(old_tos), edges_, false);
+    }
+    return result;
+}
+
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::Freeze() {
+    if (frozen_) {
+        return;
+    }
+    outgoing_.Build(incidence_lists_, edges_, true);
+    ingoing_.Build(ingoing_lists_, edges_, false);
+    incidence_lists_ = {};
+    ingoing_lists_ = {};
+    frozen_ = true;
+}
+
+template <typename Weight>
+bool DirectedWeightedGraph<Weight>::IsFrozen() const {
+    return frozen_;
+}
+
+template <typename Weight>
+memory_usage::Usage DirectedWeightedGraph<Weight>::GetMemoryUsage() const {
+    memory_usage::Usage usage = memory_usage::Measure(edges_);
+    usage += memory_usage::Measure(incidence_lists_);
+    usage += memory_usage::Measure(ingoing_lists_);
+    for (const CompressedRows* rows : {&outgoing_, &ingoing_}) {
+        usage += memory_usage::Measure(rows->offsets);
+        usage += memory_usage::Measure(rows->arcs);
+        usage += memory_usage::Measure(rows->edge_ids);
+    }
+    return usage;
+}
+
+template <typename Weight>
+uint64_t DirectedWeightedGraph<Weight>::GetGeneration() const {
+    return generation_;
+}
+
+template <typename Weight>
+typename DirectedWeightedGraph<Weight>::ArcsRange
+DirectedWeightedGraph<Weight>::GetOutgoingArcs(VertexId vertex) const {
+    if (!frozen_) {
+        throw std::logic_error("Graph should be frozen to iterate over arcs");
+    }
+    return outgoing_.GetArcs(vertex);
+}
+
+template <typename Weight>
+typename DirectedWeightedGraph<Weight>::ArcsRange
+DirectedWeightedGraph<Weight>::GetIngoingArcs(VertexId vertex) const {
+    if (!frozen_) {
+        throw std::logic_error("Graph should be frozen to iterate over arcs");
+    }
+    return ingoing_.GetArcs(vertex);
+}
+
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::CompressedRows::Build(const std::vector<IncidenceList>& lists,
+                                                          const std::vector<Edge<Weight>>& edges, bool outgoing) {
+    offsets.assign(1, 0);
+    offsets.reserve(lists.size() + 1);
+    arcs.clear();
+    arcs.reserve(edges.size());
+    edge_ids.clear();
+    edge_ids.reserve(edges.size());
+    for (const IncidenceList& list : lists) {
+        for (const EdgeId edge_id : list) {
+            const Edge<Weight>& edge = edges[edge_id];
+            arcs.push_back({outgoing ? edge.to : edge.from, edge.weight, edge_id});
+            edge_ids.push_back(edge_id);
+        }
+        offsets.push_back(arcs.size());
+    }
+}
+
+template <typename Weight>
+typename DirectedWeightedGraph<Weight>::ArcsRange
+DirectedWeightedGraph<Weight>::CompressedRows::GetArcs(VertexId vertex) const {
+    return {arcs.begin() + offsets.at(vertex), arcs.begin() + offsets.at(vertex + 1)};
+}
+
+template <typename Weight>
+typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
+DirectedWeightedGraph<Weight>::CompressedRows::GetEdgeIds(VertexId vertex) const {
+    return {edge_ids.begin() + offsets.at(vertex), edge_ids.begin() + offsets.at(vertex + 1)};
+}
+
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::CompressedRows::SetWeight(VertexId vertex, EdgeId edge_id, Weight weight) {
+    const auto begin = edge_ids.begin() + offsets[vertex];
+    const auto end = edge_ids.begin() + offsets[vertex + 1];
+    arcs[std::lower_bound(begin, end, edge_id) - edge_ids.begin()].weight = weight;
+}
+
+template <typename Weight>
+void DirectedWeightedGraph<Weight>::CompressedRows::Update(const std::vector<EdgeId>& changed, std::vector<VertexId> old_rows,
+                                                           const std::vector<Edge<Weight>>& edges, bool outgoing) {
+    auto row_of = [outgoing](const Edge<Weight>& edge) {
+        return outgoing ? edge.from : edge.to;
+    };
+    std::vector<VertexId> rows = std::move(old_rows);
+    for (const EdgeId edge_id : changed) {
+        rows.push_back(row_of(edges[edge_id]));
+    }
+    std::sort(rows.begin(), rows.end());
+    rows.erase(std::unique(rows.begin(), rows.end()), rows.end());
+
+    const size_t vertex_count = offsets.size() - 1;
+    std::vector<size_t> new_offsets;
+    std::vector<Arc<Weight>> new_arcs;
+    std::vector<EdgeId> new_edge_ids;
+    new_offsets.reserve(offsets.size());
+    new_arcs.reserve(arcs.size() + changed.size());
+    new_edge_ids.reserve(edge_ids.size() + changed.size());
+    new_offsets.push_back(0);
+    // Rows between the rebuilt ones keep their contents and move by the same shift.
+    auto copy_rows = [&](VertexId begin, VertexId end) {
+        new_arcs.insert(new_arcs.end(), arcs.begin() + offsets[begin], arcs.begin() + offsets[end]);
+        new_edge_ids.insert(new_edge_ids.end(), edge_ids.begin() + offsets[begin], edge_ids.begin() + offsets[end]);
+        const size_t shift = new_offsets.back() - offsets[begin];
+        for (VertexId vertex = begin + 1; vertex <= end; ++vertex) {
+            new_offsets.push_back(offsets[vertex] + shift);
+        }
+    };
+    std::vector<EdgeId> row;
+    VertexId next_vertex = 0;
+    for (const VertexId vertex : rows) {
+        copy_rows(next_vertex, vertex);
+        row.clear();
+        for (size_t index = offsets[vertex]; index < offsets[vertex + 1]; ++index) {
+            if (!std::binary_search(changed.begin(), changed.end(), edge_ids[index])) {
+                row.push_back(edge_ids[index]);
+            }
+        }
+        for (const EdgeId edge_id : changed) {
+            if (row_of(edges[edge_id]) == vertex) {
+                row.push_back(edge_id);
+            }
+        }
+        std::sort(row.begin(), row.end());
+        for (const EdgeId edge_id : row) {
+            const Edge<Weight>& edge = edges[edge_id];
+            new_arcs.push_back({outgoing ? edge.to : edge.from, edge.weight, edge_id});
+            new_edge_ids.push_back(edge_id);
+        }
+        new_offsets.push_back(new_arcs.size());
+        next_vertex = vertex + 1;
+    }
+    copy_rows(next_vertex, vertex_count);
+    offsets = std::move(new_offsets);
+    arcs = std::move(new_arcs);
+    edge_ids = std::move(new_edge_ids);
+}
+
+// Keeps a value of EdgePayload for every edge, indexed by edge id like the edges themselves.
+// The graph is a private base, so edges can only be added here with their payloads;
+// routers take it as a plain DirectedWeightedGraph from GetGraph.
+template <typename Weight, typename EdgePayload>
+class PayloadGraph : private DirectedWeightedGraph<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using Graph::Graph;
+
+    using Graph::GetVertexCount;
+    using Graph::GetEdgeCount;
+    using Graph::GetEdge;
+    using Graph::GetIncidentEdges;
+    using Graph::GetIngoingEdges;
+    using Graph::SetEdgeWeight;
+    using Graph::RenumberVertices;
+    using Graph::AddVertices;
+    using Graph::Freeze;
+    using Graph::IsFrozen;
+    using Graph::GetOutgoingArcs;
+    using Graph::GetIngoingArcs;
+    using Graph::GetMemoryUsage;
+    using Graph::GetGeneration;
+
+    const Graph& GetGraph() const {
+        return *this;
+    }
+
+    EdgeId AddEdge(const Edge<Weight>& edge, EdgePayload payload);
+    void ReserveEdges(size_t edge_count);
+    // The added edges get default payloads.
+    std::vector<EdgeId> UpdateEdges(const std::vector<std::pair<EdgeId, Edge<Weight>>>& updated,
+                                    const std::vector<Edge<Weight>>& added);
+
+    const EdgePayload& GetEdgePayload(EdgeId edge_id) const;
+    EdgePayload& GetEdgePayload(EdgeId edge_id);
+
+    // Only the payloads, GetMemoryUsage counts the rest.
+    memory_usage::Usage GetPayloadMemoryUsage() const;
+
+private:
+    std::vector<EdgePayload> payloads_;
+};
+
+template <typename Weight, typename EdgePayload>
+EdgeId PayloadGraph<Weight, EdgePayload>::AddEdge(const Edge<Weight>& edge, EdgePayload payload) {
+    const EdgeId id = DirectedWeightedGraph<Weight>::AddEdge(edge);
+    payloads_.push_back(std::move(payload));
+    return id;
+}
+
+template <typename Weight, typename EdgePayload>
+void PayloadGraph<Weight, EdgePayload>::ReserveEdges(size_t edge_count) {
+    DirectedWeightedGraph<Weight>::ReserveEdges(edge_count);
+    payloads_.reserve(edge_count);
+}
+
+template <typename Weight, typename EdgePayload>
+std::vector<EdgeId> PayloadGraph<Weight, EdgePayload>::UpdateEdges(const std::vector<std::pair<EdgeId, Edge<Weight>>>& updated,
+                                                                   const std::vector<Edge<Weight>>& added) {
+    std::vector<EdgeId> result = DirectedWeightedGraph<Weight>::UpdateEdges(updated, added);
+    payloads_.resize(this->GetEdgeCount());
+    return result;
+}
+
+template <typename Weight, typename EdgePayload>
+const EdgePayload& PayloadGraph<Weight, EdgePayload>::GetEdgePayload(EdgeId edge_id) const {
+    return payloads_.at(edge_id);
+}
+
+template <typename Weight, typename EdgePayload>
+EdgePayload& PayloadGraph<Weight, EdgePayload>::GetEdgePayload(EdgeId edge_id) {
+    return payloads_.at(edge_id);
+}
+
+template <typename Weight, typename EdgePayload>
+memory_usage::Usage PayloadGraph<Weight, EdgePayload>::GetPayloadMemoryUsage() const {
+    return memory_usage::Measure(payloads_);
+}
 }  // namespace graph
\ No newline at end of file
@@ -1,12 +1,20 @@
+#include <algorithm>
+#include <chrono>
+#include <climits>
 #include <cstdint>
+#include <exception>
+#include <iostream>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <utility>
 #include <vector>
 
+#include "catalogue_storage.h"
 #include "json_builder.h"
 #include "json_reader.h"
 #include "request_handler.h"
+#include "router_storage.h"
 
 namespace json_reader {
 namespace detail {
@@ -35,7 +43,7 @@ void AddBusInfo(const transport_catalogue::TransportCatalogue& catalogue, const
     using namespace std::literals::string_literals;
     using namespace json;
     if (catalogue.FindBus(command.at("name"s).AsString())) {
-        auto bus_info = catalogue.GetBusInfo(command.at("name"s).AsString());
+        const auto& bus_info = catalogue.GetBusInfo(command.at("name"s).AsString());
         builder.StartDict()
                     .Key("curvature"s).Value(bus_info.curvature)
                     .Key("request_id"s).Value(command.at("id"s).AsInt())
@@ -86,15 +94,29 @@ void AddMapInfo(const transport_catalogue::TransportCatalogue& catalogue, const
             .EndDict();
 }
 
-void AddRouteInfo(const transport_catalogue::TransportCatalogue& catalogue, const json::Dict& command, json::Builder& builder, const graph::Router<double>& router) {
+void AddRouteInfo(const transport_catalogue::TransportCatalogue& catalogue, const json::Dict& command, json::Builder& builder,
+                  const transport_router::TransportRouter& router, bool query_stats) {
     using namespace std::literals::string_literals;
     using namespace json;
-    std::optional<RouteInfo> route_info = catalogue.GetRouteInfo(command.at("from"s).AsString(), command.at("to"s).AsString(), router);
+    graph::SearchStats search_stats;
+    const auto start = std::chrono::steady_clock::now();
+    std::optional<RouteInfo> route_info = catalogue.GetRouteInfo(command.at("from"s).AsString(), command.at("to"s).AsString(), router, &search_stats);
+    const double latency_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    auto add_query_stats = [&]() {
+        if (!query_stats) {
+            return;
+        }
+        builder.Key("latency_ms"s).Value(latency_ms);
+        if (router.CountsSettledVertices()) {
+            builder.Key("settled_vertices"s).Value(static_cast<int>(search_stats.settled_vertices));
+        }
+    };
     if (!route_info.has_value()) {
         builder.StartDict()
             .Key("request_id"s).Value(command.at("id"s).AsInt())
-            .Key("error_message"s).Value("not found"s)
-            .EndDict();
+            .Key("error_message"s).Value("not found"s);
+        add_query_stats();
+        builder.EndDict();
         return;
     }
     Array ar;
@@ -116,10 +138,195 @@ void AddRouteInfo(const transport_catalogue::TransportCatalogue& catalogue, cons
     builder.StartDict()
         .Key("request_id"s).Value(command.at("id"s).AsInt())
         .Key("total_time"s).Value(route_info->all_time)
-        .Key("items"s).Value(std::move(ar))
+        .Key("items"s).Value(std::move(ar));
+    add_query_stats();
+    builder.EndDict();
+}
+
+void AddMatrixInfo(const transport_catalogue::TransportCatalogue& catalogue, const json::Dict& command, json::Builder& builder,
+                   const transport_router::TransportRouter& router, size_t thread_count) {
+    using namespace std::literals::string_literals;
+    using namespace json;
+    auto stop_names = [&catalogue](const Array& stops) -> std::optional<std::vector<std::string_view>> {
+        std::vector<std::string_view> names;
+        for (const Node& stop : stops) {
+            if (!catalogue.FindStop(stop.AsString())) {
+                return std::nullopt;
+            }
+            names.push_back(stop.AsString());
+        }
+        return names;
+    };
+    const auto from = stop_names(command.at("from"s).AsArray());
+    const auto to = stop_names(command.at("to"s).AsArray());
+    if (!from || !to) {
+        builder.StartDict()
+            .Key("request_id"s).Value(command.at("id"s).AsInt())
+            .Key("error_message"s).Value("not found"s)
+            .EndDict();
+        return;
+    }
+    const std::vector<std::optional<double>> times = catalogue.GetTravelTimes(*from, *to, router, thread_count);
+    Array rows;
+    rows.reserve(from->size());
+    for (size_t i = 0; i < from->size(); ++i) {
+        Array row;
+        row.reserve(to->size());
+        for (size_t j = 0; j < to->size(); ++j) {
+            const std::optional<double>& time = times[i * to->size() + j];
+            row.push_back(time ? Node(*time) : Node(nullptr));
+        }
+        rows.push_back(std::move(row));
+    }
+    builder.StartDict()
+        .Key("request_id"s).Value(command.at("id"s).AsInt())
+        .Key("total_times"s).Value(std::move(rows))
         .EndDict();
 }
 
+memory_usage::Report GetMemoryUsage(const transport_catalogue::TransportCatalogue& catalogue,
+                                    const transport_router::TransportRouter& router) {
+    memory_usage::Report report = catalogue.GetMemoryUsage();
+    for (memory_usage::Entry& entry : router.GetMemoryUsage()) {
+        report.push_back(std::move(entry));
+    }
+    return report;
+}
+
+// Ints are 32-bit in json, larger counts go as doubles.
+json::Node CountToNode(size_t count) {
+    if (count <= static_cast<size_t>(INT_MAX)) {
+        return json::Node(static_cast<int>(count));
+    }
+    return json::Node(static_cast<double>(count));
+}
+
+void AddMemoryInfo(const transport_catalogue::TransportCatalogue& catalogue, const json::Dict& command, json::Builder& builder,
+                   const transport_router::TransportRouter& router) {
+    using namespace std::literals::string_literals;
+    using namespace json;
+    const memory_usage::Report report = GetMemoryUsage(catalogue, router);
+    Array structures;
+    structures.reserve(report.size());
+    for (const memory_usage::Entry& entry : report) {
+        Dict dict;
+        dict["name"s] = entry.name;
+        dict["bytes"s] = CountToNode(entry.usage.bytes);
+        dict["overhead_bytes"s] = CountToNode(entry.usage.overhead);
+        dict["allocations"s] = CountToNode(entry.usage.allocations);
+        structures.push_back(std::move(dict));
+    }
+    const memory_usage::Usage total = memory_usage::GetTotal(report);
+    builder.StartDict()
+        .Key("request_id"s).Value(command.at("id"s).AsInt())
+        .Key("total_bytes"s).Value(CountToNode(total.bytes).GetValue())
+        .Key("total_overhead_bytes"s).Value(CountToNode(total.overhead).GetValue())
+        .Key("structures"s).Value(std::move(structures));
+    if (const std::optional<graph::ShortestPathCacheStats> cache_stats = router.GetCacheStats()) {
+        Dict cache;
+        cache["hits"s] = CountToNode(cache_stats->hits);
+        cache["misses"s] = CountToNode(cache_stats->misses);
+        cache["evictions"s] = CountToNode(cache_stats->evictions);
+        cache["cached_trees"s] = CountToNode(cache_stats->cached_trees);
+        cache["used_bytes"s] = CountToNode(cache_stats->used_bytes);
+        cache["budget_bytes"s] = CountToNode(cache_stats->budget_bytes);
+        builder.Key("shortest_path_cache"s).Value(std::move(cache));
+    }
+    builder.EndDict();
+}
+
+transport_router::RouterSettings GetRouterSettings(const json::Dict& routing_settings) {
+    using namespace std::literals::string_literals;
+    transport_router::RouterSettings settings;
+    if (routing_settings.count("router_type"s)) {
+        settings.type = transport_router::ParseRouterType(routing_settings.at("router_type"s).AsString());
+    }
+    if (routing_settings.count("router_threads"s)) {
+        settings.thread_count = std::max(1, routing_settings.at("router_threads"s).AsInt());
+    }
+    if (routing_settings.count("router_float_weights"s)) {
+        settings.float_weights = routing_settings.at("router_float_weights"s).AsBool();
+    }
+    if (routing_settings.count("router_cache_bytes"s)) {
+        settings.cache_budget_bytes = static_cast<size_t>(std::max(0., routing_settings.at("router_cache_bytes"s).AsDouble()));
+    }
+    if (routing_settings.count("router_landmarks"s)) {
+        settings.landmark_count = std::max(1, routing_settings.at("router_landmarks"s).AsInt());
+    }
+    if (routing_settings.count("router_vertex_order"s)) {
+        settings.vertex_order = transport_router::ParseVertexOrder(routing_settings.at("router_vertex_order"s).AsString());
+    }
+    if (routing_settings.count("router_query_stats"s)) {
+        settings.query_stats = routing_settings.at("router_query_stats"s).AsBool();
+    }
+    if (routing_settings.count("router_table_file"s)) {
+        settings.table_file = routing_settings.at("router_table_file"s).AsString();
+    }
+    return settings;
+}
+
+// The tables are only a cache: when they cannot be saved the router built in memory still serves.
+template <typename Save>
+void SaveTables(const std::string& path, Save save) {
+    using namespace std::literals::string_literals;
+    try {
+        save();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "Routing tables are not saved to "s << path << ": "s << e.what() << std::endl;
+    }
+}
+
+transport_router::TransportRouter CreateRouter(const transport_catalogue::TransportCatalogue& catalogue,
+    const transport_router::RouterSettings& settings) {
+    if (settings.type == transport_router::RouterType::RAPTOR) {
+        return transport_router::TransportRouter(line_router::LineRouter(catalogue));
+    }
+    if (settings.type == transport_router::RouterType::ALT && !settings.table_file.empty()) {
+        if (auto tables = router_storage::LoadLandmarks(settings.table_file, catalogue, settings.landmark_count)) {
+            return transport_router::TransportRouter(catalogue.GetGraph(), graph::AltRouter<double>(catalogue.GetGraph(), std::move(*tables)));
+        }
+        transport_router::TransportRouter router(catalogue.GetGraph(), settings);
+        SaveTables(settings.table_file, [&] {
+            router_storage::SaveLandmarks(settings.table_file, catalogue, router.GetAltRouter()->GetLandmarkTables(),
+                                          settings.landmark_count);
+        });
+        return router;
+    }
+    if (settings.table_file.empty() || settings.type != transport_router::RouterType::FLOYD_WARSHALL || settings.float_weights) {
+        return transport_router::TransportRouter(catalogue.GetGraph(), settings);
+    }
+    if (auto mapped_router = router_storage::LoadRouter(settings.table_file, catalogue)) {
+        return transport_router::TransportRouter(catalogue.GetGraph(), std::move(*mapped_router));
+    }
+    transport_router::TransportRouter router(catalogue.GetGraph(), settings);
+    SaveTables(settings.table_file, [&] {
+        router_storage::SaveRouter(settings.table_file, catalogue, *router.GetAllPairsRouter());
+    });
+    return router;
+}
+
+void ApplyRoutingSettings(transport_catalogue::TransportCatalogue& catalogue, const catalogue_storage::RoutingSettings& settings) {
+    catalogue.AddRoutingSettings(settings.bus_velocity, settings.bus_wait_time);
+    if (settings.router.type != transport_router::RouterType::RAPTOR) {
+        catalogue.CreateGraph(settings.router.thread_count, settings.router.vertex_order);
+    }
+}
+
+catalogue_storage::RoutingSettings GetRoutingSettings(const json::Dict& routing_settings) {
+    using namespace std::literals::string_literals;
+    catalogue_storage::RoutingSettings settings;
+    settings.bus_velocity = routing_settings.at("bus_velocity"s).AsDouble();
+    settings.bus_wait_time = routing_settings.at("bus_wait_time"s).AsInt();
+    settings.router = GetRouterSettings(routing_settings);
+    return settings;
+}
+
+const std::string& GetBaseFile(const json::Dict& root) {
+    using namespace std::literals::string_literals;
+    return root.at("serialization_settings"s).AsDict().at("file"s).AsString();
+}
+
 svg::Color GetColor(const json::Node& color) {
     if (color.IsString()) {
         return color.AsString();
@@ -140,6 +347,28 @@ svg::Color GetColor(const json::Node& color) {
     }
 }
 
+map_renderer::RenderSettings GetRenderSettings(const json::Dict& settings_map) {
+    using namespace std::literals::string_literals;
+    map_renderer::RenderSettings settings;
+    settings.width = settings_map.at("width"s).AsDouble();
+    settings.height = settings_map.at("height"s).AsDouble();
+    settings.padding = settings_map.at("padding"s).AsDouble();
+    settings.line_width = settings_map.at("line_width"s).AsDouble();
+    settings.stop_radius = settings_map.at("stop_radius"s).AsDouble();
+    settings.bus_label_font_size = settings_map.at("bus_label_font_size"s).AsInt();
+    settings.bus_label_offset = { settings_map.at("bus_label_offset"s).AsArray()[0].AsDouble(),
+                                   settings_map.at("bus_label_offset"s).AsArray()[1].AsDouble() };
+    settings.stop_label_font_size = settings_map.at("stop_label_font_size"s).AsInt();
+    settings.stop_label_offset = { settings_map.at("stop_label_offset"s).AsArray()[0].AsDouble(),
+                                    settings_map.at("stop_label_offset"s).AsArray()[1].AsDouble() };
+    settings.underlayer_color = GetColor(settings_map.at("underlayer_color"s));
+    settings.underlayer_width = settings_map.at("underlayer_width"s).AsDouble();
+    for (const auto& color: settings_map.at("color_palette"s).AsArray()) {
+        settings.color_palette.push_back(GetColor(color));
+    }
+    return settings;
+}
+
 } // detail
 
 JsonReader::JsonReader(std::istream& input)
@@ -174,20 +403,47 @@ void JsonReader::ApplyBaseCommands([[maybe_unused]] transport_catalogue::Transpo
             catalogue.AddBus(com.at("name"s).AsString(), detail::Route(com), com.at("is_roundtrip"s).AsBool());
         }
     }
+    const json::Dict& root = document_.GetRoot().AsDict();
+    catalogue.Finalize(root.count("routing_settings"s)
+                       ? detail::GetRouterSettings(root.at("routing_settings"s).AsDict()).thread_count
+                       : 1);
 }
 
 void JsonReader::AddRoutingSettings(transport_catalogue::TransportCatalogue& catalogue) const {
     using namespace std::literals::string_literals;
-    const json::Dict& settings_map = document_.GetRoot().AsDict().at("routing_settings"s).AsDict();
-    catalogue.AddRoutingSettings(settings_map.at("bus_velocity"s).AsDouble(), settings_map.at("bus_wait_time"s).AsInt());
-    catalogue.CreateGraph();
+    detail::ApplyRoutingSettings(catalogue, detail::GetRoutingSettings(document_.GetRoot().AsDict().at("routing_settings"s).AsDict()));
 }
 
 void JsonReader::ApplyStatCommands(const transport_catalogue::TransportCatalogue& catalogue,
     const map_renderer::MapRenderer& map_renderer, std::ostream& output) const {
     using namespace std::literals::string_literals;
+    const json::Dict& routing_settings = document_.GetRoot().AsDict().at("routing_settings"s).AsDict();
+    const transport_router::RouterSettings router_settings = detail::GetRouterSettings(routing_settings);
+    const transport_router::TransportRouter router = detail::CreateRouter(catalogue, router_settings);
+    ApplyStatCommands(catalogue, map_renderer, router, router_settings, output);
+}
+
+std::unique_ptr<snapshot::Snapshot> JsonReader::BuildSnapshot(uint64_t version) const {
+    using namespace std::literals::string_literals;
+    auto result = std::make_unique<snapshot::Snapshot>();
+    result->version = version;
+    ApplyBaseCommands(result->catalogue);
+    AddRoutingSettings(result->catalogue);
+    result->router_settings = detail::GetRouterSettings(document_.GetRoot().AsDict().at("routing_settings"s).AsDict());
+    result->router.emplace(detail::CreateRouter(result->catalogue, result->router_settings));
+    return result;
+}
+
+void JsonReader::ApplyStatCommands(const snapshot::Snapshot& snapshot, const map_renderer::MapRenderer& map_renderer,
+    std::ostream& output) const {
+    ApplyStatCommands(snapshot.catalogue, map_renderer, *snapshot.router, snapshot.router_settings, output);
+}
+
+void JsonReader::ApplyStatCommands(const transport_catalogue::TransportCatalogue& catalogue,
+    const map_renderer::MapRenderer& map_renderer, const transport_router::TransportRouter& router,
+    const transport_router::RouterSettings& router_settings, std::ostream& output) const {
+    using namespace std::literals::string_literals;
     using namespace json;
-    graph::Router<double> router(catalogue.GetGraph());
     Builder builder;
     builder.StartArray();
     for (const auto& command : document_.GetRoot().AsDict().at("stat_requests"s).AsArray()) {
@@ -201,7 +457,13 @@ void JsonReader::ApplyStatCommands(const transport_catalogue::TransportCatalogue
             detail::AddMapInfo(catalogue, map_renderer, command.AsDict(), builder);
         }
         else if (command.AsDict().at("type"s).AsString() == "Route"s) {
-            detail::AddRouteInfo(catalogue, command.AsDict(), builder, router);
+            detail::AddRouteInfo(catalogue, command.AsDict(), builder, router, router_settings.query_stats);
+        }
+        else if (command.AsDict().at("type"s).AsString() == "Matrix"s) {
+            detail::AddMatrixInfo(catalogue, command.AsDict(), builder, router, router_settings.thread_count);
+        }
+        else if (command.AsDict().at("type"s).AsString() == "Memory"s) {
+            detail::AddMemoryInfo(catalogue, command.AsDict(), builder, router);
         }
     }
     builder.EndArray();
@@ -210,26 +472,47 @@ void JsonReader::ApplyStatCommands(const transport_catalogue::TransportCatalogue
 
 void JsonReader::HandleRenderSettings(map_renderer::MapRenderer& map_render) {
     using namespace std::literals::string_literals;
-    map_renderer::RenderSettings settings;
-    const auto& settings_map = document_.GetRoot().AsDict().at("render_settings"s).AsDict();
-    settings.width = settings_map.at("width"s).AsDouble();
-    settings.height = settings_map.at("height"s).AsDouble();
-    settings.padding = settings_map.at("padding"s).AsDouble();
-    settings.line_width = settings_map.at("line_width"s).AsDouble();
-    settings.stop_radius = settings_map.at("stop_radius"s).AsDouble();
-    settings.bus_label_font_size = settings_map.at("bus_label_font_size"s).AsInt();
-    settings.bus_label_offset = { settings_map.at("bus_label_offset"s).AsArray()[0].AsDouble(),
-                                   settings_map.at("bus_label_offset"s).AsArray()[1].AsDouble() };
-    settings.stop_label_font_size = settings_map.at("stop_label_font_size"s).AsInt();
-    settings.stop_label_offset = { settings_map.at("stop_label_offset"s).AsArray()[0].AsDouble(),
-                                    settings_map.at("stop_label_offset"s).AsArray()[1].AsDouble() };
-    settings.underlayer_color = detail::GetColor(settings_map.at("underlayer_color"s));
-    settings.underlayer_width = settings_map.at("underlayer_width"s).AsDouble();
-    for (const auto& color: settings_map.at("color_palette"s).AsArray()) {
-        settings.color_palette.push_back(detail::GetColor(color));
+    map_render.SetSettings(detail::GetRenderSettings(document_.GetRoot().AsDict().at("render_settings"s).AsDict()));
+}
+
+void JsonReader::BuildBase() const {
+    using namespace std::literals::string_literals;
+    const json::Dict& root = document_.GetRoot().AsDict();
+    transport_catalogue::TransportCatalogue catalogue;
+    ApplyBaseCommands(catalogue);
+    catalogue_storage::Settings settings;
+    if (root.count("routing_settings"s)) {
+        settings.routing = detail::GetRoutingSettings(root.at("routing_settings"s).AsDict());
+    }
+    if (root.count("render_settings"s)) {
+        settings.render = detail::GetRenderSettings(root.at("render_settings"s).AsDict());
     }
+    catalogue_storage::SaveBase(detail::GetBaseFile(root), catalogue, settings);
+}
 
-    map_render.SetSettings(std::move(settings));
+void JsonReader::ServeRequests(std::ostream& output) const {
+    transport_catalogue::TransportCatalogue catalogue;
+    const catalogue_storage::Settings settings = catalogue_storage::LoadBase(detail::GetBaseFile(document_.GetRoot().AsDict()), catalogue);
+    map_renderer::MapRenderer renderer;
+    if (settings.render) {
+        renderer.SetSettings(*settings.render);
+    }
+    // Without stored routing settings the defaults of the catalogue and the router are used.
+    const catalogue_storage::RoutingSettings routing = settings.routing.value_or(catalogue_storage::RoutingSettings{});
+    detail::ApplyRoutingSettings(catalogue, routing);
+    const transport_router::TransportRouter router = detail::CreateRouter(catalogue, routing.router);
+    ApplyStatCommands(catalogue, renderer, router, routing.router, output);
+}
+
+void JsonReader::PrintMemoryUsage(std::ostream& output) const {
+    using namespace std::literals::string_literals;
+    transport_catalogue::TransportCatalogue catalogue;
+    ApplyBaseCommands(catalogue);
+    AddRoutingSettings(catalogue);
+    const transport_router::RouterSettings router_settings =
+        detail::GetRouterSettings(document_.GetRoot().AsDict().at("routing_settings"s).AsDict());
+    const transport_router::TransportRouter router = detail::CreateRouter(catalogue, router_settings);
+    memory_usage::PrintReport(detail::GetMemoryUsage(catalogue, router), output);
 }
 
 } // json_reader
\ No newline at end of file
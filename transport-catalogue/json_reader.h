@@ -1,8 +1,11 @@
 #pragma once
+#include <cstdint>
+#include <memory>
 #include <sstream>
 
 #include "json.h"
 #include "map_renderer.h"
+#include "snapshot.h"
 #include "transport_catalogue.h"
 
 namespace json_reader {
@@ -17,7 +20,27 @@ public:
     void HandleRenderSettings(map_renderer::MapRenderer& map_render);
     void AddRoutingSettings(transport_catalogue::TransportCatalogue& catalogue) const;
 
+    // Loads the base requests and routing settings into a new snapshot and builds its router.
+    std::unique_ptr<snapshot::Snapshot> BuildSnapshot(uint64_t version) const;
+    // Answers with the snapshot's router instead of building one.
+    void ApplyStatCommands(const snapshot::Snapshot& snapshot, const map_renderer::MapRenderer& map_renderer,
+                           std::ostream& output) const;
+
+    // Saves the base requests with the routing and render settings to serialization_settings.file.
+    void BuildBase() const;
+    // Loads the catalogue and the settings from serialization_settings.file and answers the stat requests.
+    void ServeRequests(std::ostream& output) const;
+
+    // Builds the catalogue and the router like a run without stat requests and prints the memory
+    // they take by structure, the same as the Memory stat request gives. The shortest path cache
+    // counters are left out: no route was asked yet. The Memory stat request reports them.
+    void PrintMemoryUsage(std::ostream& output) const;
+
 private:
+    void ApplyStatCommands(const transport_catalogue::TransportCatalogue& catalogue, const map_renderer::MapRenderer& map_renderer,
+                           const transport_router::TransportRouter& router, const transport_router::RouterSettings& router_settings,
+                           std::ostream& output) const;
+
     json::Document document_;
 };
 
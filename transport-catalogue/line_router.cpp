@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+
+#include "line_router.h"
+#include "transport_catalogue.h"
+
+namespace line_router {
+
+namespace {
+
+constexpr double NO_ROUTE = std::numeric_limits<double>::infinity();
+
+}
+
+LineRouter::LineRouter(const transport_catalogue::TransportCatalogue& catalogue)
+    : catalogue_(&catalogue)
+    , catalogue_generation_(catalogue.GetGeneration())
+    , bus_velocity_(catalogue.GetBusVelocity())
+    , bus_wait_time_(catalogue.GetBusWaitTime())
+{
+    for (const Bus& bus : catalogue.GetAllBuses()) {
+        for (const Stop* stop : bus.route) {
+            if (stop_ids_.emplace(stop, static_cast<StopId>(stop_names_.size())).second) {
+                stop_names_.push_back(stop->name);
+            }
+        }
+        if (bus.ring) {
+            AddLine(bus, 0, bus.route.size(), true, catalogue);
+        }
+        else {
+            AddLine(bus, 0, bus.route.size() / 2 + 1, false, catalogue);
+            AddLine(bus, bus.route.size() / 2, bus.route.size(), false, catalogue);
+        }
+    }
+
+    std::vector<uint32_t> counts(stop_names_.size() + 1, 0);
+    for (const StopId stop : line_stops_) {
+        ++counts[stop + 1];
+    }
+    for (size_t i = 1; i < counts.size(); ++i) {
+        counts[i] += counts[i - 1];
+    }
+    stop_positions_begin_ = counts;
+    stop_positions_.resize(line_stops_.size());
+    for (uint32_t line = 0; line < lines_.size(); ++line) {
+        for (uint32_t position = lines_[line].begin; position < lines_[line].end; ++position) {
+            stop_positions_[counts[line_stops_[position]]++] = { line, position };
+        }
+    }
+}
+
+void LineRouter::AddLine(const Bus& bus, size_t begin, size_t end, bool skip_boarding_stop,
+                         const transport_catalogue::TransportCatalogue& catalogue) {
+    if (end <= begin + 1) {
+        return;
+    }
+    Line line;
+    line.bus_name = bus.name;
+    line.begin = static_cast<uint32_t>(line_stops_.size());
+    line.skip_boarding_stop = skip_boarding_stop;
+    for (size_t i = begin; i < end; ++i) {
+        line_stops_.push_back(stop_ids_.at(bus.route[i]));
+        line_distances_.push_back(i == begin ? 0 : catalogue.GetDistance(bus.route[i - 1]->name, bus.route[i]->name));
+    }
+    line.end = static_cast<uint32_t>(line_stops_.size());
+    lines_.push_back(line);
+}
+
+LineRouter::StopId LineRouter::GetStopId(const Stop* stop) const {
+    const auto it = stop_ids_.find(stop);
+    return it == stop_ids_.end() ? NONE : it->second;
+}
+
+void LineRouter::CheckCatalogue() const {
+    if (catalogue_->GetGeneration() != catalogue_generation_) {
+        throw std::logic_error("The catalogue changed after the router was built");
+    }
+}
+
+LineRouter::SearchResult LineRouter::Search(StopId source, StopId target) const {
+    SearchResult result;
+    result.times.assign(stop_names_.size(), NO_ROUTE);
+    result.parents.resize(stop_names_.size());
+    std::vector<double>& times = result.times;
+    auto target_time = [&]() {
+        return target == NONE ? NO_ROUTE : times[target];
+    };
+
+    std::vector<StopId> marked_stops = { source };
+    std::vector<bool> is_marked(stop_names_.size(), false);
+    std::vector<uint32_t> first_marked_position(lines_.size(), NONE);
+    std::vector<uint32_t> lines_to_scan;
+    times[source] = 0.;
+
+    while (!marked_stops.empty()) {
+        for (const StopId stop : marked_stops) {
+            is_marked[stop] = false;
+            for (uint32_t i = stop_positions_begin_[stop]; i < stop_positions_begin_[stop + 1]; ++i) {
+                const StopPosition& stop_position = stop_positions_[i];
+                uint32_t& first_position = first_marked_position[stop_position.line];
+                if (first_position == NONE) {
+                    lines_to_scan.push_back(stop_position.line);
+                }
+                first_position = std::min(first_position, stop_position.position);
+            }
+        }
+        marked_stops.clear();
+
+        for (const uint32_t line_id : lines_to_scan) {
+            const Line& line = lines_[line_id];
+            uint32_t board_position = NONE;
+            double board_time = 0.;
+            int ride_length = 0;
+            for (uint32_t position = first_marked_position[line_id]; position < line.end; ++position) {
+                const StopId stop = line_stops_[position];
+                double ride_arrival = NO_ROUTE;
+                if (board_position != NONE
+                    && !(line.skip_boarding_stop && stop == line_stops_[board_position]))
+                {
+                    ride_length += line_distances_[position];
+                    const double ride_time = ride_length / bus_velocity_ * 60. / 1000.;
+                    ride_arrival = board_time + bus_wait_time_ + ride_time;
+                    if (ride_arrival < times[stop] && ride_arrival < target_time()) {
+                        times[stop] = ride_arrival;
+                        result.parents[stop] = { line_id, board_position, position, ride_time };
+                        if (!is_marked[stop]) {
+                            is_marked[stop] = true;
+                            marked_stops.push_back(stop);
+                        }
+                    }
+                }
+                if (position + 1 < line.end && times[stop] < NO_ROUTE
+                    && (board_position == NONE || times[stop] + bus_wait_time_ < board_time + bus_wait_time_
+                        + ride_length / bus_velocity_ * 60. / 1000.))
+                {
+                    board_position = position;
+                    board_time = times[stop];
+                    ride_length = 0;
+                }
+            }
+            first_marked_position[line_id] = NONE;
+        }
+        lines_to_scan.clear();
+    }
+    return result;
+}
+
+std::optional<RouteInfo> LineRouter::BuildRoute(const Stop* from, const Stop* to) const {
+    CheckCatalogue();
+    if (from == to) {
+        return RouteInfo{ 0., {} };
+    }
+    const StopId source = GetStopId(from);
+    const StopId target = GetStopId(to);
+    if (source == NONE || target == NONE) {
+        return std::nullopt;
+    }
+    const SearchResult search_result = Search(source, target);
+    if (search_result.times[target] == NO_ROUTE) {
+        return std::nullopt;
+    }
+
+    RouteInfo result;
+    result.all_time = search_result.times[target];
+    for (StopId stop = target; stop != source && result.edges.size() < 2 * stop_names_.size();) {
+        const Parent& parent = search_result.parents[stop];
+        const Line& line = lines_[parent.line];
+        result.edges.push_back({ line.bus_name, parent.ride_time, static_cast<int>(parent.alight_position - parent.board_position) });
+        stop = line_stops_[parent.board_position];
+        result.edges.push_back({ stop_names_[stop], bus_wait_time_ });
+    }
+    std::reverse(result.edges.begin(), result.edges.end());
+    return result;
+}
+
+std::vector<std::optional<double>> LineRouter::GetTravelTimes(const Stop* from, const std::vector<const Stop*>& to) const {
+    CheckCatalogue();
+    std::vector<std::optional<double>> result(to.size());
+    const StopId source = GetStopId(from);
+    const std::vector<double> times = source == NONE ? std::vector<double>() : Search(source, NONE).times;
+    for (size_t i = 0; i < to.size(); ++i) {
+        if (to[i] == from) {
+            result[i] = 0.;
+            continue;
+        }
+        const StopId target = GetStopId(to[i]);
+        if (source != NONE && target != NONE && times[target] != NO_ROUTE) {
+            result[i] = times[target];
+        }
+    }
+    return result;
+}
+
+memory_usage::Usage LineRouter::GetMemoryUsage() const {
+    memory_usage::Usage usage = memory_usage::Measure(stop_ids_);
+    usage += memory_usage::Measure(stop_names_);
+    usage += memory_usage::Measure(lines_);
+    usage += memory_usage::Measure(line_stops_);
+    usage += memory_usage::Measure(line_distances_);
+    usage += memory_usage::Measure(stop_positions_begin_);
+    usage += memory_usage::Measure(stop_positions_);
+    return usage;
+}
+
+} // line_router
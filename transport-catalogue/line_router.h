@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "domain.h"
+#include "memory_usage.h"
+
+namespace transport_catalogue {
+class TransportCatalogue;
+}
+
+namespace line_router {
+
+// Round-based search over the buses' stop sequences in the style of RAPTOR. Every round scans the
+// lines passing through the stops improved in the previous one, so rides between all pairs of
+// stops of a bus are never stored. Ride times are computed exactly like the edges of
+// TransportCatalogue::CreateGraph, so routes cost the same. Once the catalogue changes, the queries
+// throw std::logic_error and the router should be created again.
+class LineRouter {
+public:
+    explicit LineRouter(const transport_catalogue::TransportCatalogue& catalogue);
+
+    std::optional<RouteInfo> BuildRoute(const Stop* from, const Stop* to) const;
+
+    // Total times from one stop to each of the given ones, nullopt when there is no route.
+    std::vector<std::optional<double>> GetTravelTimes(const Stop* from, const std::vector<const Stop*>& to) const;
+
+    memory_usage::Usage GetMemoryUsage() const;
+
+private:
+    using StopId = uint32_t;
+    static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+    // A ring bus is one line. Other buses are two lines, there and back: a ride never passes
+    // the final stop. Positions index line_stops_ and line_distances_.
+    struct Line {
+        std::string_view bus_name;
+        uint32_t begin;
+        uint32_t end;
+        // Like CreateGraph, a ring bus gives no ride back to the boarding stop and skips the
+        // distance to it when it is passed on the way.
+        bool skip_boarding_stop;
+    };
+
+    struct StopPosition {
+        uint32_t line;
+        uint32_t position;
+    };
+
+    struct Parent {
+        uint32_t line = NONE;
+        uint32_t board_position = NONE;
+        uint32_t alight_position = NONE;
+        double ride_time = 0.;
+    };
+
+    struct SearchResult {
+        std::vector<double> times;
+        std::vector<Parent> parents;
+    };
+
+    void AddLine(const Bus& bus, size_t begin, size_t end, bool skip_boarding_stop,
+                 const transport_catalogue::TransportCatalogue& catalogue);
+
+    StopId GetStopId(const Stop* stop) const;
+
+    void CheckCatalogue() const;
+
+    // Stops improving the labels that cannot beat the target's one; target may be NONE.
+    SearchResult Search(StopId source, StopId target) const;
+
+    const transport_catalogue::TransportCatalogue* catalogue_;
+    uint64_t catalogue_generation_;
+    double bus_velocity_;
+    double bus_wait_time_;
+    std::unordered_map<const Stop*, StopId> stop_ids_;
+    std::vector<std::string_view> stop_names_;
+    std::vector<Line> lines_;
+    std::vector<StopId> line_stops_;
+    // Distance from the previous position of the line, 0 at its beginning.
+    std::vector<int> line_distances_;
+    // Positions of every stop on the lines: stop_positions_[stop_positions_begin_[s] .. stop_positions_begin_[s + 1]).
+    std::vector<uint32_t> stop_positions_begin_;
+    std::vector<StopPosition> stop_positions_;
+};
+
+} // line_router
@@ -1,4 +1,5 @@
 #include <iostream>
+#include <string_view>
 
 #include "json_reader.h"
 #include "map_renderer.h"
@@ -7,7 +8,31 @@
 using namespace std;
 using namespace transport_catalogue;
 
-int main() {
+// Without arguments the base and stat requests are answered in one run. build-base saves the base
+// requests with the settings to serialization_settings.file, serve-requests answers the stat requests
+// with the data loaded from it. memory-usage prints the memory the catalogue and the router take.
+int main(int argc, char* argv[]) {
+    const string_view mode = argc > 1 ? argv[1] : ""sv;
+    if (mode == "build-base"sv) {
+        json_reader::JsonReader reader(cin);
+        reader.BuildBase();
+        return 0;
+    }
+    if (mode == "serve-requests"sv) {
+        json_reader::JsonReader reader(cin);
+        reader.ServeRequests(cout);
+        return 0;
+    }
+    if (mode == "memory-usage"sv) {
+        json_reader::JsonReader reader(cin);
+        reader.PrintMemoryUsage(cout);
+        return 0;
+    }
+    if (!mode.empty()) {
+        cerr << "Usage: "sv << argv[0] << " [build-base|serve-requests|memory-usage]"sv << endl;
+        return 1;
+    }
+
     TransportCatalogue catalogue;
     json_reader::JsonReader reader(cin);
     reader.ApplyBaseCommands(catalogue);
@@ -16,4 +41,4 @@ int main() {
     map_renderer::MapRenderer renderer;
     reader.HandleRenderSettings(renderer);
     reader.ApplyStatCommands(catalogue, renderer, cout);
-}
\ No newline at end of file
+}
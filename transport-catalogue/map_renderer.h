@@ -89,19 +89,12 @@ SphereProjector::SphereProjector(PointInputIt points_begin, PointInputIt points_
         return;
     }
 
-    //       
-    const auto [left_it, right_it] = std::minmax_element(
-        points_begin, points_end,
-        [](auto lhs, auto rhs) { return lhs.lng < rhs.lng; });
-    min_lon_ = left_it->lng;
-    const double max_lon = right_it->lng;
-
-    //       
-    const auto [bottom_it, top_it] = std::minmax_element(
-        points_begin, points_end,
-        [](auto lhs, auto rhs) { return lhs.lat < rhs.lat; });
-    const double min_lat = bottom_it->lat;
-    max_lat_ = top_it->lat;
+    //          
+    const geo::Bounds bounds = geo::ComputeBounds(points_begin, points_end);
+    min_lon_ = bounds.min_lng;
+    const double max_lon = bounds.max_lng;
+    const double min_lat = bounds.min_lat;
+    max_lat_ = bounds.max_lat;
 
     //      x
     std::optional<double> width_zoom;
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Answers queries from Router's all-pairs tables placed in memory it does not own,
+// e.g. a read-only file mapping that storage keeps alive.
+template <typename Weight>
+class MappedRouter {
+public:
+    using RouteInfo = typename Router<Weight>::RouteInfo;
+    using PrevEdge = typename Router<Weight>::PrevEdge;
+
+    struct Tables {
+        size_t vertex_count = 0;
+        size_t edge_count = 0;
+        const Weight* weights = nullptr;
+        const PrevEdge* prev_edges = nullptr;
+        const uint32_t* edge_sources = nullptr;
+    };
+
+    MappedRouter(const Tables& tables, std::shared_ptr<const void> storage);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+
+    // Size of the tables in the storage, mapped file pages rather than heap where mmap is available.
+    size_t GetTableBytes() const;
+
+private:
+    Tables tables_;
+    std::shared_ptr<const void> storage_;
+};
+
+template <typename Weight>
+MappedRouter<Weight>::MappedRouter(const Tables& tables, std::shared_ptr<const void> storage)
+    : tables_(tables)
+    , storage_(std::move(storage))
+{
+}
+
+template <typename Weight>
+std::optional<typename MappedRouter<Weight>::RouteInfo> MappedRouter<Weight>::BuildRoute(VertexId from,
+                                                                                         VertexId to) const {
+    if (from >= tables_.vertex_count || to >= tables_.vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    const size_t row = from * tables_.vertex_count;
+    const PrevEdge last_edge = tables_.prev_edges[row + to];
+    if (last_edge == Router<Weight>::NO_ROUTE) {
+        return std::nullopt;
+    }
+    std::vector<EdgeId> edges;
+    for (PrevEdge edge_id = last_edge;
+         edge_id != Router<Weight>::NO_PREV_EDGE;
+         edge_id = tables_.prev_edges[row + tables_.edge_sources[edge_id]])
+    {
+        if (edge_id >= tables_.edge_count || edges.size() >= tables_.vertex_count) {
+            throw std::runtime_error("Routes table is corrupted");
+        }
+        edges.push_back(edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+
+    return RouteInfo{tables_.weights[row + to], std::move(edges)};
+}
+
+template <typename Weight>
+size_t MappedRouter<Weight>::GetTableBytes() const {
+    return tables_.vertex_count * tables_.vertex_count * (sizeof(Weight) + sizeof(PrevEdge))
+        + tables_.edge_count * sizeof(uint32_t);
+}
+
+}  // namespace graph
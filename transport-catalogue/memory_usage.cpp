@@ -0,0 +1,76 @@
+#include <iomanip>
+#include <string_view>
+
+#include "memory_usage.h"
+
+namespace memory_usage {
+
+namespace {
+
+constexpr size_t SIZE_WORD = sizeof(size_t);
+constexpr size_t CHUNK_ALIGNMENT = 16;
+constexpr size_t MIN_CHUNK = 32;
+// The default threshold of glibc, above it a chunk is mapped with two size words in front.
+constexpr size_t MMAP_THRESHOLD = 128 * 1024;
+constexpr size_t PAGE_SIZE = 4096;
+
+size_t AlignUp(size_t size, size_t alignment) {
+    return (size + alignment - 1) / alignment * alignment;
+}
+
+size_t GetChunkSize(size_t size) {
+    if (size + SIZE_WORD >= MMAP_THRESHOLD) {
+        return AlignUp(size + 2 * SIZE_WORD, PAGE_SIZE);
+    }
+    return std::max(MIN_CHUNK, AlignUp(size + SIZE_WORD, CHUNK_ALIGNMENT));
+}
+
+} // namespace
+
+void Usage::AddAllocation(size_t size) {
+    AddAllocations(size, 1);
+}
+
+void Usage::AddAllocations(size_t size, size_t count) {
+    if (size == 0 || count == 0) {
+        return;
+    }
+    bytes += size * count;
+    overhead += (GetChunkSize(size) - size) * count;
+    allocations += count;
+}
+
+Usage& Usage::operator+=(const Usage& other) {
+    bytes += other.bytes;
+    overhead += other.overhead;
+    allocations += other.allocations;
+    return *this;
+}
+
+Usage GetTotal(const Report& report) {
+    Usage total;
+    for (const Entry& entry : report) {
+        total += entry.usage;
+    }
+    return total;
+}
+
+void PrintReport(const Report& report, std::ostream& output) {
+    using namespace std::literals::string_view_literals;
+    size_t name_width = "total"sv.size();
+    for (const Entry& entry : report) {
+        name_width = std::max(name_width, entry.name.size());
+    }
+    auto print_line = [&](std::string_view name, const auto& bytes, const auto& overhead, const auto& allocations) {
+        output << std::left << std::setw(static_cast<int>(name_width)) << name << std::right
+               << std::setw(16) << bytes << std::setw(16) << overhead << std::setw(14) << allocations << '\n';
+    };
+    print_line("structure"sv, "bytes"sv, "overhead"sv, "allocations"sv);
+    for (const Entry& entry : report) {
+        print_line(entry.name, entry.usage.bytes, entry.usage.overhead, entry.usage.allocations);
+    }
+    const Usage total = GetTotal(report);
+    print_line("total"sv, total.bytes, total.overhead, total.allocations);
+}
+
+} // memory_usage
@@ -0,0 +1,85 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace memory_usage {
+
+// Heap memory a structure holds. bytes is what it asked the allocator for, spare capacity included,
+// overhead is an estimate of what the allocator adds to that: glibc malloc keeps a size word before
+// every chunk and rounds chunks up to 16 bytes, 32 at least, and maps the large ones in whole pages.
+struct Usage {
+    size_t bytes = 0;
+    size_t overhead = 0;
+    size_t allocations = 0;
+
+    void AddAllocation(size_t size);
+    // Adds count blocks of size bytes each.
+    void AddAllocations(size_t size, size_t count);
+
+    Usage& operator+=(const Usage& other);
+};
+
+struct Entry {
+    std::string name;
+    Usage usage;
+};
+
+using Report = std::vector<Entry>;
+
+Usage GetTotal(const Report& report);
+
+// A line per entry and the total, in bytes.
+void PrintReport(const Report& report, std::ostream& output);
+
+template <typename T>
+Usage Measure(const std::vector<T>& values) {
+    Usage usage;
+    usage.AddAllocation(values.capacity() * sizeof(T));
+    return usage;
+}
+
+template <typename T>
+Usage Measure(const std::vector<std::vector<T>>& values) {
+    Usage usage;
+    usage.AddAllocation(values.capacity() * sizeof(std::vector<T>));
+    for (const std::vector<T>& inner : values) {
+        usage += Measure(inner);
+    }
+    return usage;
+}
+
+// The elements' own heap memory is not counted. Blocks and their map as libstdc++ lays them out:
+// 512-byte blocks, or one element per block for the larger ones, the first block allocated up front.
+template <typename T>
+Usage Measure(const std::deque<T>& values) {
+    constexpr size_t BLOCK_BYTES = 512;
+    constexpr size_t block_size = sizeof(T) < BLOCK_BYTES ? BLOCK_BYTES / sizeof(T) : 1;
+    const size_t block_count = values.size() / block_size + 1;
+    Usage usage;
+    usage.AddAllocations(block_size * sizeof(T), block_count);
+    usage.AddAllocation(std::max<size_t>(8, block_count + 2) * sizeof(T*));
+    return usage;
+}
+
+// A node per element holding the next pointer and the value, and the bucket array unless there is
+// only one bucket, which lives inside the map. Hashes cached in the nodes are not counted.
+template <typename Key, typename Value, typename Hash, typename Equal, typename Allocator>
+Usage Measure(const std::unordered_map<Key, Value, Hash, Equal, Allocator>& values) {
+    struct Node {
+        void* next;
+        typename std::unordered_map<Key, Value, Hash, Equal, Allocator>::value_type value;
+    };
+    Usage usage;
+    usage.AddAllocations(sizeof(Node), values.size());
+    if (values.bucket_count() > 1) {
+        usage.AddAllocation(values.bucket_count() * sizeof(void*));
+    }
+    return usage;
+}
+
+} // memory_usage
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+// Calls func(index) for every index in [0, task_count) on up to thread_count threads.
+// The calling thread takes part in the work; the first thrown exception is rethrown after all threads stop.
+template <typename Func>
+void ParallelFor(size_t task_count, size_t thread_count, const Func& func) {
+    thread_count = std::min(thread_count, task_count);
+    if (thread_count <= 1) {
+        for (size_t index = 0; index < task_count; ++index) {
+            func(index);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next_index{0};
+    std::exception_ptr exception;
+    std::mutex exception_mutex;
+    auto worker = [&]() {
+        for (size_t index = next_index++; index < task_count; index = next_index++) {
+            try {
+                func(index);
+            }
+            catch (...) {
+                std::lock_guard guard(exception_mutex);
+                if (!exception) {
+                    exception = std::current_exception();
+                }
+                next_index = task_count;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(thread_count - 1);
+    for (size_t i = 1; i < thread_count; ++i) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+}
+
+}  // namespace parallel
@@ -1,117 +1,291 @@
 #pragma once
 
 #include "graph.h"
+#include "parallel.h"
 
 #include <algorithm>
-#include <cassert>
 #include <cstdint>
 #include <iterator>
+#include <limits>
 #include <optional>
 #include <stdexcept>
-#include <unordered_map>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
 namespace graph {
 
 template <typename Weight>
+struct RouteInfo {
+    Weight weight;
+    std::vector<EdgeId> edges;
+};
+
+// Filled in by the engines that search per query.
+struct SearchStats {
+    size_t settled_vertices = 0;
+};
+
+// All-pairs routes in two flat V x V arrays: the weights and the 32-bit id of the last edge.
+// StoredWeight = float halves the table at the cost of ~7 significant digits in the sums compared
+// while relaxing: routes whose weights differ by less than that may be swapped. The weight of a
+// built route is summed again from the graph's edges in Weight, so only the choice between such
+// near-equal routes is affected.
+template <typename Weight, typename StoredWeight = Weight>
 class Router {
 private:
     using Graph = DirectedWeightedGraph<Weight>;
 
 public:
-    explicit Router(const Graph& graph);
+    explicit Router(const Graph& graph, size_t thread_count = 1);
 
-    struct RouteInfo {
-        Weight weight;
-        std::vector<EdgeId> edges;
-    };
+    using RouteInfo = graph::RouteInfo<Weight>;
 
     std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
 
+    using PrevEdge = uint32_t;
+    static constexpr PrevEdge NO_ROUTE = std::numeric_limits<PrevEdge>::max();
+    static constexpr PrevEdge NO_PREV_EDGE = NO_ROUTE - 1;
+
+    // Row-major V x V tables, the row is the source vertex.
+    const std::vector<StoredWeight>& GetWeights() const {
+        return weights_;
+    }
+
+    const std::vector<PrevEdge>& GetPrevEdges() const {
+        return prev_edges_;
+    }
+
 private:
+    static_assert(std::numeric_limits<StoredWeight>::has_infinity, "Router stores unreachable routes as infinity");
+
     struct RouteInternalData {
-        Weight weight;
-        std::optional<EdgeId> prev_edge;
+        StoredWeight weight;
+        PrevEdge prev_edge = NO_ROUTE;
+
+        bool HasRoute() const {
+            return prev_edge != NO_ROUTE;
+        }
     };
-    using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
+
+    size_t GetIndex(VertexId vertex_from, VertexId vertex_to) const {
+        return vertex_from * vertex_count_ + vertex_to;
+    }
+
+    RouteInternalData GetRouteInternalData(VertexId vertex_from, VertexId vertex_to) const {
+        const size_t index = GetIndex(vertex_from, vertex_to);
+        return {weights_[index], prev_edges_[index]};
+    }
 
     void InitializeRoutesInternalData(const Graph& graph) {
-        const size_t vertex_count = graph.GetVertexCount();
-        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-            routes_internal_data_[vertex][vertex] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
+        if (graph.GetEdgeCount() >= NO_PREV_EDGE) {
+            throw std::length_error("Too many edges for 32-bit edge ids");
+        }
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            weights_[GetIndex(vertex, vertex)] = ZERO_WEIGHT;
+            prev_edges_[GetIndex(vertex, vertex)] = NO_PREV_EDGE;
             for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
                 const auto& edge = graph.GetEdge(edge_id);
-                if (edge.weight < ZERO_WEIGHT) {
+                if (edge.weight < Weight{}) {
                     throw std::domain_error("Edges' weights should be non-negative");
                 }
-                auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                if (!route_internal_data || route_internal_data->weight > edge.weight) {
-                    route_internal_data = RouteInternalData{edge.weight, edge_id};
+                const size_t index = GetIndex(vertex, edge.to);
+                const StoredWeight weight = static_cast<StoredWeight>(edge.weight);
+                if (weights_[index] > weight) {
+                    weights_[index] = weight;
+                    prev_edges_[index] = static_cast<PrevEdge>(edge_id);
                 }
             }
         }
     }
 
-    void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
-                    const RouteInternalData& route_to) {
-        auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-        const Weight candidate_weight = route_from.weight + route_to.weight;
-        if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-            route_relaxing = {candidate_weight,
-                              route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge};
+    // Unreachable cells weigh +infinity, so a candidate through an unreachable cell never wins.
+    void RelaxRow(VertexId vertex_from, RouteInternalData route_from, const StoredWeight* weights_to,
+                  const PrevEdge* prev_edges_to, VertexId begin, VertexId end) {
+        StoredWeight* const weights = weights_.data() + GetIndex(vertex_from, 0);
+        PrevEdge* const prev_edges = prev_edges_.data() + GetIndex(vertex_from, 0);
+        for (VertexId vertex_to = begin; vertex_to < end; ++vertex_to) {
+            const StoredWeight candidate_weight = route_from.weight + weights_to[vertex_to];
+            if (candidate_weight < weights[vertex_to]) {
+                weights[vertex_to] = candidate_weight;
+                prev_edges[vertex_to] = prev_edges_to[vertex_to] != NO_PREV_EDGE ? prev_edges_to[vertex_to]
+                                                                                : route_from.prev_edge;
+            }
         }
     }
 
-    void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
-        for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-            if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
-                for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                    if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-                        RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
+    // Floyd-Warshall over TILE_SIZE x TILE_SIZE tiles. For every block of pivots the diagonal tile,
+    // then the tiles of the pivot rows and columns, then all the other tiles are relaxed. Row k and
+    // column k are saved at the moment pivot k is processed, so every cell sees the same candidates
+    // in the same order as in the plain row-at-a-time algorithm and gets bit-identical data.
+    class BlockedRelaxation {
+    public:
+        BlockedRelaxation(Router& router, size_t vertex_count, size_t thread_count)
+            : router_(router)
+            , vertex_count_(vertex_count)
+            , thread_count_(thread_count)
+            , tile_count_((vertex_count + TILE_SIZE - 1) / TILE_SIZE)
+            , pivot_row_weights_(TILE_SIZE * vertex_count)
+            , pivot_row_prev_edges_(TILE_SIZE * vertex_count)
+            , pivot_columns_(vertex_count * TILE_SIZE) {
+        }
+
+        void Run() {
+            for (size_t pivot_tile = 0; pivot_tile < tile_count_; ++pivot_tile) {
+                RelaxDiagonalTile(pivot_tile);
+                parallel::ParallelFor(2 * tile_count_, thread_count_, [this, pivot_tile](size_t task) {
+                    const size_t tile = task / 2;
+                    if (tile == pivot_tile) {
+                        return;
+                    }
+                    if (task % 2 == 0) {
+                        RelaxPivotRowTile(pivot_tile, tile);
+                    }
+                    else {
+                        RelaxPivotColumnTile(pivot_tile, tile);
                     }
+                });
+                parallel::ParallelFor(tile_count_ * tile_count_, thread_count_, [this, pivot_tile](size_t task) {
+                    const size_t row_tile = task / tile_count_;
+                    const size_t column_tile = task % tile_count_;
+                    if (row_tile != pivot_tile && column_tile != pivot_tile) {
+                        RelaxRemainingTile(pivot_tile, row_tile, column_tile);
+                    }
+                });
+            }
+        }
+
+    private:
+        using Cell = RouteInternalData;
+
+        std::pair<size_t, size_t> GetTileBounds(size_t tile) const {
+            return {tile * TILE_SIZE, std::min(vertex_count_, (tile + 1) * TILE_SIZE)};
+        }
+
+        void SavePivotRow(VertexId pivot, VertexId begin, VertexId end) {
+            const size_t offset = (pivot % TILE_SIZE) * vertex_count_;
+            for (VertexId vertex_to = begin; vertex_to < end; ++vertex_to) {
+                const Cell cell = router_.GetRouteInternalData(pivot, vertex_to);
+                pivot_row_weights_[offset + vertex_to] = cell.weight;
+                pivot_row_prev_edges_[offset + vertex_to] = cell.prev_edge;
+            }
+        }
+
+        void SavePivotColumn(VertexId pivot, VertexId begin, VertexId end) {
+            for (VertexId vertex_from = begin; vertex_from < end; ++vertex_from) {
+                PivotColumn(vertex_from, pivot) = router_.GetRouteInternalData(vertex_from, pivot);
+            }
+        }
+
+        void RelaxThroughPivot(VertexId pivot, VertexId row_begin, VertexId row_end,
+                               VertexId column_begin, VertexId column_end) {
+            const size_t offset = (pivot % TILE_SIZE) * vertex_count_;
+            for (VertexId vertex_from = row_begin; vertex_from < row_end; ++vertex_from) {
+                if (const Cell& route_from = PivotColumn(vertex_from, pivot); route_from.HasRoute()) {
+                    router_.RelaxRow(vertex_from, route_from, pivot_row_weights_.data() + offset,
+                                     pivot_row_prev_edges_.data() + offset, column_begin, column_end);
                 }
             }
         }
-    }
 
-    static constexpr Weight ZERO_WEIGHT{};
+        Cell& PivotColumn(VertexId vertex_from, VertexId pivot) {
+            return pivot_columns_[vertex_from * TILE_SIZE + pivot % TILE_SIZE];
+        }
+
+        void RelaxDiagonalTile(size_t pivot_tile) {
+            const auto [begin, end] = GetTileBounds(pivot_tile);
+            for (VertexId pivot = begin; pivot < end; ++pivot) {
+                SavePivotRow(pivot, begin, end);
+                SavePivotColumn(pivot, begin, end);
+                RelaxThroughPivot(pivot, begin, end, begin, end);
+            }
+        }
+
+        void RelaxPivotRowTile(size_t pivot_tile, size_t column_tile) {
+            const auto [pivot_begin, pivot_end] = GetTileBounds(pivot_tile);
+            const auto [begin, end] = GetTileBounds(column_tile);
+            for (VertexId pivot = pivot_begin; pivot < pivot_end; ++pivot) {
+                SavePivotRow(pivot, begin, end);
+                RelaxThroughPivot(pivot, pivot_begin, pivot_end, begin, end);
+            }
+        }
+
+        void RelaxPivotColumnTile(size_t pivot_tile, size_t row_tile) {
+            const auto [pivot_begin, pivot_end] = GetTileBounds(pivot_tile);
+            const auto [begin, end] = GetTileBounds(row_tile);
+            for (VertexId pivot = pivot_begin; pivot < pivot_end; ++pivot) {
+                SavePivotColumn(pivot, begin, end);
+                RelaxThroughPivot(pivot, begin, end, pivot_begin, pivot_end);
+            }
+        }
+
+        void RelaxRemainingTile(size_t pivot_tile, size_t row_tile, size_t column_tile) {
+            const auto [pivot_begin, pivot_end] = GetTileBounds(pivot_tile);
+            const auto [row_begin, row_end] = GetTileBounds(row_tile);
+            const auto [column_begin, column_end] = GetTileBounds(column_tile);
+            for (VertexId pivot = pivot_begin; pivot < pivot_end; ++pivot) {
+                RelaxThroughPivot(pivot, row_begin, row_end, column_begin, column_end);
+            }
+        }
+
+        Router& router_;
+        size_t vertex_count_;
+        size_t thread_count_;
+        size_t tile_count_;
+        std::vector<StoredWeight> pivot_row_weights_;
+        std::vector<PrevEdge> pivot_row_prev_edges_;
+        std::vector<Cell> pivot_columns_;
+    };
+
+    static constexpr size_t TILE_SIZE = 32;
+    static constexpr StoredWeight ZERO_WEIGHT{};
     const Graph& graph_;
-    RoutesInternalData routes_internal_data_;
+    size_t vertex_count_;
+    std::vector<StoredWeight> weights_;
+    std::vector<PrevEdge> prev_edges_;
 };
 
-template <typename Weight>
-Router<Weight>::Router(const Graph& graph)
+template <typename Weight, typename StoredWeight>
+Router<Weight, StoredWeight>::Router(const Graph& graph, size_t thread_count)
     : graph_(graph)
-    , routes_internal_data_(graph.GetVertexCount(),
-                            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
+    , vertex_count_(graph.GetVertexCount())
+    , weights_(vertex_count_ * vertex_count_, std::numeric_limits<StoredWeight>::infinity())
+    , prev_edges_(vertex_count_ * vertex_count_, NO_ROUTE)
 {
     InitializeRoutesInternalData(graph);
 
-    const size_t vertex_count = graph.GetVertexCount();
-    for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-        RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
-    }
+    BlockedRelaxation(*this, vertex_count_, thread_count).Run();
 }
 
-template <typename Weight>
-std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
-                                                                             VertexId to) const {
-    const auto& route_internal_data = routes_internal_data_.at(from).at(to);
-    if (!route_internal_data) {
+template <typename Weight, typename StoredWeight>
+std::optional<typename Router<Weight, StoredWeight>::RouteInfo>
+Router<Weight, StoredWeight>::BuildRoute(VertexId from, VertexId to) const {
+    if (from >= vertex_count_ || to >= vertex_count_) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    const RouteInternalData route_internal_data = GetRouteInternalData(from, to);
+    if (!route_internal_data.HasRoute()) {
         return std::nullopt;
     }
-    const Weight weight = route_internal_data->weight;
     std::vector<EdgeId> edges;
-    for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
-         edge_id;
-         edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+    for (PrevEdge edge_id = route_internal_data.prev_edge;
+         edge_id != NO_PREV_EDGE;
+         edge_id = prev_edges_[GetIndex(from, graph_.GetEdge(edge_id).from)])
     {
-        edges.push_back(*edge_id);
+        edges.push_back(edge_id);
     }
     std::reverse(edges.begin(), edges.end());
 
-    return RouteInfo{weight, std::move(edges)};
+    if constexpr (std::is_same_v<Weight, StoredWeight>) {
+        return RouteInfo{route_internal_data.weight, std::move(edges)};
+    }
+    else {
+        Weight weight{};
+        for (const EdgeId edge_id : edges) {
+            weight += graph_.GetEdge(edge_id).weight;
+        }
+        return RouteInfo{weight, std::move(edges)};
+    }
 }
 
 }  // namespace graph
\ No newline at end of file
@@ -0,0 +1,345 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "router_storage.h"
+#include "temp_file.h"
+
+namespace router_storage {
+namespace detail {
+
+using PrevEdge = graph::Router<double>::PrevEdge;
+
+using Magic = char[8];
+constexpr Magic ROUTES_MAGIC = {'T', 'C', 'R', 'O', 'U', 'T', 'E', 'S'};
+constexpr Magic LANDMARKS_MAGIC = {'T', 'C', 'L', 'A', 'N', 'D', 'M', 'K'};
+constexpr uint32_t VERSION = 3;
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t weight_size;
+    uint64_t input_hash;
+    uint64_t vertex_count;
+    uint64_t edge_count;
+    uint64_t graph_size;
+    // Landmarks stored, fewer than requested when the graph has not enough vertices to pick.
+    uint64_t landmark_count;
+    // What the tables were computed for, the key of a landmarks file next to the input hash.
+    uint64_t requested_landmark_count;
+};
+
+struct EdgeRecord {
+    uint32_t to;
+    int32_t span_count;
+    double weight;
+    double time;
+    uint32_t name_offset;
+    uint32_t name_size;
+};
+
+size_t AlignUp(size_t size) {
+    return (size + 7) / 8 * 8;
+}
+
+// Sections follow the header: edge sources, edge records and names, then the tables: weights and
+// previous edges of Router or landmark ids and distances of AltRouter.
+// Every section starts at a multiple of 8, so the mapped tables are properly aligned.
+struct Layout {
+    size_t weights_offset;
+    size_t prev_edges_offset;
+    size_t file_size;
+};
+
+Layout GetLayout(size_t vertex_count, size_t graph_size) {
+    Layout layout;
+    layout.weights_offset = sizeof(FileHeader) + AlignUp(graph_size);
+    layout.prev_edges_offset = layout.weights_offset + vertex_count * vertex_count * sizeof(double);
+    layout.file_size = layout.prev_edges_offset + vertex_count * vertex_count * sizeof(PrevEdge);
+    return layout;
+}
+
+struct LandmarksLayout {
+    size_t landmarks_offset;
+    size_t to_landmarks_offset;
+    size_t from_landmarks_offset;
+    size_t file_size;
+};
+
+LandmarksLayout GetLandmarksLayout(size_t vertex_count, size_t graph_size, size_t landmark_count) {
+    LandmarksLayout layout;
+    layout.landmarks_offset = sizeof(FileHeader) + AlignUp(graph_size);
+    layout.to_landmarks_offset = layout.landmarks_offset + landmark_count * sizeof(uint64_t);
+    layout.from_landmarks_offset = layout.to_landmarks_offset + vertex_count * landmark_count * sizeof(double);
+    layout.file_size = layout.from_landmarks_offset + vertex_count * landmark_count * sizeof(double);
+    return layout;
+}
+
+template <typename T>
+void AppendBytes(std::vector<char>& bytes, const T& value) {
+    const char* begin = reinterpret_cast<const char*>(&value);
+    bytes.insert(bytes.end(), begin, begin + sizeof(T));
+}
+
+// The graph sections exactly as they are stored: both the key and the check against collisions.
+std::vector<char> SerializeGraph(const transport_catalogue::TransportCatalogue& catalogue) {
+    const auto& transport_graph = catalogue.GetGraph();
+    const size_t edge_count = transport_graph.GetEdgeCount();
+    std::vector<char> bytes;
+    for (graph::EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+        AppendBytes(bytes, static_cast<uint32_t>(transport_graph.GetEdge(edge_id).from));
+    }
+    bytes.resize(AlignUp(bytes.size()));
+
+    std::vector<char> names;
+    for (graph::EdgeId edge_id = 0; edge_id < edge_count; ++edge_id) {
+        const auto& edge = transport_graph.GetEdge(edge_id);
+        const EdgeInfo& edge_info = catalogue.GetEdgeInfo(edge_id);
+        EdgeRecord record{};
+        record.to = static_cast<uint32_t>(edge.to);
+        record.span_count = edge_info.span_count;
+        record.weight = edge.weight;
+        record.time = edge_info.time;
+        record.name_offset = static_cast<uint32_t>(names.size());
+        record.name_size = static_cast<uint32_t>(edge_info.name.size());
+        AppendBytes(bytes, record);
+        names.insert(names.end(), edge_info.name.begin(), edge_info.name.end());
+    }
+    bytes.insert(bytes.end(), names.begin(), names.end());
+    return bytes;
+}
+
+// FNV-1a
+uint64_t ComputeHash(const std::vector<char>& bytes, uint64_t vertex_count) {
+    uint64_t hash = 14695981039346656037ull;
+    auto add = [&hash](unsigned char byte) {
+        hash = (hash ^ byte) * 1099511628211ull;
+    };
+    for (size_t i = 0; i < sizeof(vertex_count); ++i) {
+        add(static_cast<unsigned char>(vertex_count >> (8 * i)));
+    }
+    for (const char byte : bytes) {
+        add(static_cast<unsigned char>(byte));
+    }
+    return hash;
+}
+
+// Read-only view of a whole file. Processes mapping the same file share its pages.
+class MappedFile {
+public:
+    static std::shared_ptr<const MappedFile> Open(const std::string& path);
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    ~MappedFile();
+
+    const char* GetData() const {
+        return data_;
+    }
+
+    size_t GetSize() const {
+        return size_;
+    }
+
+private:
+    MappedFile() = default;
+
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    std::vector<char> buffer_;
+#endif
+};
+
+#ifdef _WIN32
+
+// No mmap here: the file is read into memory, which keeps the format and checks the same.
+std::shared_ptr<const MappedFile> MappedFile::Open(const std::string& path) {
+    std::ifstream input(path, std::ios::binary);
+    if (!input) {
+        return nullptr;
+    }
+    std::shared_ptr<MappedFile> file(new MappedFile());
+    file->buffer_.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    file->data_ = file->buffer_.data();
+    file->size_ = file->buffer_.size();
+    return file;
+}
+
+MappedFile::~MappedFile() = default;
+
+#else
+
+std::shared_ptr<const MappedFile> MappedFile::Open(const std::string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat file_stat;
+    void* data = MAP_FAILED;
+    if (fstat(fd, &file_stat) == 0 && file_stat.st_size > 0) {
+        data = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (data == MAP_FAILED) {
+        return nullptr;
+    }
+    std::shared_ptr<MappedFile> file(new MappedFile());
+    file->data_ = static_cast<const char*>(data);
+    file->size_ = static_cast<size_t>(file_stat.st_size);
+    return file;
+}
+
+MappedFile::~MappedFile() {
+    munmap(const_cast<char*>(data_), size_);
+}
+
+#endif
+
+FileHeader MakeHeader(const Magic& magic, const transport_catalogue::TransportCatalogue& catalogue,
+                      const std::vector<char>& graph_bytes) {
+    FileHeader header{};
+    std::memcpy(header.magic, magic, sizeof(Magic));
+    header.version = VERSION;
+    header.weight_size = sizeof(double);
+    header.input_hash = ComputeHash(graph_bytes, catalogue.GetGraph().GetVertexCount());
+    header.vertex_count = catalogue.GetGraph().GetVertexCount();
+    header.edge_count = catalogue.GetGraph().GetEdgeCount();
+    header.graph_size = graph_bytes.size();
+    return header;
+}
+
+// Maps the file if it has the expected kind and was built for exactly this graph.
+std::shared_ptr<const MappedFile> OpenMatching(const std::string& path, const Magic& magic,
+                                               const transport_catalogue::TransportCatalogue& catalogue,
+                                               const std::vector<char>& graph_bytes, FileHeader& header) {
+    const auto file = MappedFile::Open(path);
+    if (!file || file->GetSize() < sizeof(FileHeader)) {
+        return nullptr;
+    }
+    std::memcpy(&header, file->GetData(), sizeof(header));
+    const FileHeader expected = MakeHeader(magic, catalogue, graph_bytes);
+    if (std::memcmp(header.magic, expected.magic, sizeof(Magic)) != 0
+        || header.version != expected.version
+        || header.weight_size != expected.weight_size
+        || header.vertex_count != expected.vertex_count
+        || header.edge_count != expected.edge_count
+        || header.graph_size != expected.graph_size
+        || header.input_hash != expected.input_hash
+        || file->GetSize() < sizeof(FileHeader) + graph_bytes.size()
+        || std::memcmp(file->GetData() + sizeof(FileHeader), graph_bytes.data(), graph_bytes.size()) != 0)
+    {
+        return nullptr;
+    }
+    return file;
+}
+
+// write_tables(output) appends the tables after the header and the graph sections.
+template <typename WriteTables>
+void WriteFile(const std::string& path, const FileHeader& header, std::vector<char> graph_bytes,
+               WriteTables write_tables) {
+    using namespace std::literals::string_literals;
+    graph_bytes.resize(AlignUp(graph_bytes.size()));
+    temp_file::WriteReplacing(path, "routing tables"s, [&](std::ostream& output) {
+        output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        output.write(graph_bytes.data(), static_cast<std::streamsize>(graph_bytes.size()));
+        write_tables(output);
+    });
+}
+
+template <typename T>
+void WriteVector(std::ostream& output, const std::vector<T>& values) {
+    output.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(T)));
+}
+
+} // detail
+
+std::optional<graph::MappedRouter<double>> LoadRouter(const std::string& path,
+                                                      const transport_catalogue::TransportCatalogue& catalogue) {
+    using namespace detail;
+    const auto& transport_graph = catalogue.GetGraph();
+    const std::vector<char> graph_bytes = SerializeGraph(catalogue);
+    FileHeader header;
+    const auto file = OpenMatching(path, ROUTES_MAGIC, catalogue, graph_bytes, header);
+    const Layout layout = GetLayout(transport_graph.GetVertexCount(), graph_bytes.size());
+    if (!file || file->GetSize() != layout.file_size) {
+        return std::nullopt;
+    }
+
+    graph::MappedRouter<double>::Tables tables;
+    tables.vertex_count = transport_graph.GetVertexCount();
+    tables.edge_count = transport_graph.GetEdgeCount();
+    tables.weights = reinterpret_cast<const double*>(file->GetData() + layout.weights_offset);
+    tables.prev_edges = reinterpret_cast<const PrevEdge*>(file->GetData() + layout.prev_edges_offset);
+    tables.edge_sources = reinterpret_cast<const uint32_t*>(file->GetData() + sizeof(FileHeader));
+    return graph::MappedRouter<double>(tables, file);
+}
+
+void SaveRouter(const std::string& path, const transport_catalogue::TransportCatalogue& catalogue,
+                const graph::Router<double>& router) {
+    using namespace detail;
+    std::vector<char> graph_bytes = SerializeGraph(catalogue);
+    const FileHeader header = MakeHeader(ROUTES_MAGIC, catalogue, graph_bytes);
+    WriteFile(path, header, std::move(graph_bytes), [&router](std::ostream& output) {
+        WriteVector(output, router.GetWeights());
+        WriteVector(output, router.GetPrevEdges());
+    });
+}
+
+std::optional<graph::AltRouter<double>::LandmarkTables> LoadLandmarks(const std::string& path,
+                                                                      const transport_catalogue::TransportCatalogue& catalogue,
+                                                                      size_t landmark_count) {
+    using namespace detail;
+    const size_t vertex_count = catalogue.GetGraph().GetVertexCount();
+    const std::vector<char> graph_bytes = SerializeGraph(catalogue);
+    FileHeader header;
+    const auto file = OpenMatching(path, LANDMARKS_MAGIC, catalogue, graph_bytes, header);
+    if (!file || header.requested_landmark_count != landmark_count || header.landmark_count > landmark_count) {
+        return std::nullopt;
+    }
+    const LandmarksLayout layout = GetLandmarksLayout(vertex_count, graph_bytes.size(), header.landmark_count);
+    if (file->GetSize() != layout.file_size) {
+        return std::nullopt;
+    }
+
+    graph::AltRouter<double>::LandmarkTables tables;
+    const auto* landmarks = reinterpret_cast<const uint64_t*>(file->GetData() + layout.landmarks_offset);
+    const auto* to_landmarks = reinterpret_cast<const double*>(file->GetData() + layout.to_landmarks_offset);
+    const auto* from_landmarks = reinterpret_cast<const double*>(file->GetData() + layout.from_landmarks_offset);
+    const size_t table_size = vertex_count * header.landmark_count;
+    tables.landmarks.assign(landmarks, landmarks + header.landmark_count);
+    tables.to_landmarks.assign(to_landmarks, to_landmarks + table_size);
+    tables.from_landmarks.assign(from_landmarks, from_landmarks + table_size);
+    return tables;
+}
+
+void SaveLandmarks(const std::string& path, const transport_catalogue::TransportCatalogue& catalogue,
+                   const graph::AltRouter<double>::LandmarkTables& tables, size_t landmark_count) {
+    using namespace detail;
+    std::vector<char> graph_bytes = SerializeGraph(catalogue);
+    FileHeader header = MakeHeader(LANDMARKS_MAGIC, catalogue, graph_bytes);
+    header.landmark_count = tables.landmarks.size();
+    header.requested_landmark_count = landmark_count;
+    WriteFile(path, header, std::move(graph_bytes), [&tables](std::ostream& output) {
+        const std::vector<uint64_t> landmarks(tables.landmarks.begin(), tables.landmarks.end());
+        WriteVector(output, landmarks);
+        WriteVector(output, tables.to_landmarks);
+        WriteVector(output, tables.from_landmarks);
+    });
+}
+
+} // router_storage
@@ -0,0 +1,32 @@
+#pragma once
+#include <optional>
+#include <string>
+
+#include "alt_router.h"
+#include "mapped_router.h"
+#include "router.h"
+#include "transport_catalogue.h"
+
+namespace router_storage {
+
+// A file holds the graph with its edge metadata and the tables of one engine. It is keyed by a hash
+// of the graph and the metadata, which covers both the base data and the routing settings.
+// Loading returns nullopt when the file is missing, belongs to another engine or was built for other inputs.
+std::optional<graph::MappedRouter<double>> LoadRouter(const std::string& path,
+                                                      const transport_catalogue::TransportCatalogue& catalogue);
+
+// Writes a temporary file of its own next to path and renames it, so readers never map a partial file
+// and processes saving at once do not clash. Throws like temp_file::WriteReplacing.
+void SaveRouter(const std::string& path, const transport_catalogue::TransportCatalogue& catalogue,
+                const graph::Router<double>& router);
+
+std::optional<graph::AltRouter<double>::LandmarkTables> LoadLandmarks(const std::string& path,
+                                                                      const transport_catalogue::TransportCatalogue& catalogue,
+                                                                      size_t landmark_count);
+
+// landmark_count is the number the tables were computed for, which LoadLandmarks compares with the
+// one it is given: the tables may hold fewer landmarks than that.
+void SaveLandmarks(const std::string& path, const transport_catalogue::TransportCatalogue& catalogue,
+                   const graph::AltRouter<double>::LandmarkTables& tables, size_t landmark_count);
+
+} // router_storage
@@ -0,0 +1,85 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "snapshot.h"
+
+namespace snapshot {
+
+SnapshotStore::Guard::Guard(std::atomic<uint64_t>& epoch, const Snapshot* snapshot)
+    : epoch_(epoch)
+    , snapshot_(snapshot)
+{
+}
+
+SnapshotStore::Guard::~Guard() {
+    epoch_.store(IDLE);
+}
+
+SnapshotStore::Reader::Reader(SnapshotStore& store)
+    : store_(store)
+    , slot_(MAX_READERS)
+{
+    for (size_t slot = 0; slot < MAX_READERS; ++slot) {
+        bool taken = false;
+        if (store_.readers_[slot].taken.compare_exchange_strong(taken, true)) {
+            slot_ = slot;
+            return;
+        }
+    }
+    throw std::length_error("Too many snapshot readers");
+}
+
+SnapshotStore::Reader::~Reader() {
+    store_.readers_[slot_].taken.store(false);
+}
+
+SnapshotStore::Guard SnapshotStore::Reader::Acquire() const {
+    std::atomic<uint64_t>& epoch = store_.readers_[slot_].epoch;
+    if (epoch.load(std::memory_order_relaxed) != IDLE) {
+        throw std::logic_error("The reader already holds a snapshot");
+    }
+    // Announcing before loading: a writer that reads this slot as idle has swapped the pointer already,
+    // one that reads an epoch not older than a snapshot's retirement knows it was loaded after the swap.
+    epoch.store(store_.epoch_.load());
+    return Guard(epoch, store_.current_.load());
+}
+
+SnapshotStore::SnapshotStore(std::unique_ptr<const Snapshot> snapshot)
+    : current_(snapshot.release())
+{
+}
+
+SnapshotStore::~SnapshotStore() {
+    delete current_.load();
+}
+
+void SnapshotStore::Publish(std::unique_ptr<const Snapshot> snapshot) {
+    std::lock_guard guard(writer_mutex_);
+    const Snapshot* replaced = current_.exchange(snapshot.release());
+    const uint64_t epoch = ++epoch_;
+    if (replaced) {
+        retired_.emplace_back(epoch, replaced);
+    }
+    ReclaimLocked();
+}
+
+size_t SnapshotStore::Reclaim() {
+    std::lock_guard guard(writer_mutex_);
+    return ReclaimLocked();
+}
+
+size_t SnapshotStore::ReclaimLocked() {
+    uint64_t oldest_epoch = epoch_.load();
+    for (const ReaderSlot& reader : readers_) {
+        const uint64_t epoch = reader.epoch.load();
+        if (epoch != IDLE) {
+            oldest_epoch = std::min(oldest_epoch, epoch);
+        }
+    }
+    retired_.erase(std::remove_if(retired_.begin(), retired_.end(), [oldest_epoch](const auto& retired) {
+        return retired.first <= oldest_epoch;
+    }), retired_.end());
+    return retired_.size();
+}
+
+} // snapshot
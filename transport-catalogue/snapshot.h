@@ -0,0 +1,104 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+namespace snapshot {
+
+// One version of the data, immutable once published. The router refers to the catalogue's graph,
+// so a snapshot is built in place and never moved.
+struct Snapshot {
+    uint64_t version = 0;
+    transport_catalogue::TransportCatalogue catalogue;
+    transport_router::RouterSettings router_settings;
+    std::optional<transport_router::TransportRouter> router;
+};
+
+// Hands the current snapshot to readers while a writer replaces it. Readers never lock or wait:
+// a reader announces the epoch it starts in and then loads the pointer. Publish swaps the pointer and
+// advances the epoch, the replaced snapshot is deleted by a later Publish or Reclaim once every reader
+// that could have loaded it is done.
+class SnapshotStore {
+public:
+    static constexpr size_t MAX_READERS = 64;
+
+    // Keeps the snapshot it was acquired with readable until it is destroyed.
+    class Guard {
+    public:
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+        ~Guard();
+
+        const Snapshot& operator*() const {
+            return *snapshot_;
+        }
+
+        const Snapshot* operator->() const {
+            return snapshot_;
+        }
+
+    private:
+        friend class SnapshotStore;
+
+        Guard(std::atomic<uint64_t>& epoch, const Snapshot* snapshot);
+
+        std::atomic<uint64_t>& epoch_;
+        const Snapshot* snapshot_;
+    };
+
+    // A reader slot for one thread, which holds at most one guard at a time.
+    // Throws std::length_error when all MAX_READERS slots are taken.
+    class Reader {
+    public:
+        explicit Reader(SnapshotStore& store);
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+        ~Reader();
+
+        Guard Acquire() const;
+
+    private:
+        SnapshotStore& store_;
+        size_t slot_;
+    };
+
+    explicit SnapshotStore(std::unique_ptr<const Snapshot> snapshot);
+    SnapshotStore(const SnapshotStore&) = delete;
+    SnapshotStore& operator=(const SnapshotStore&) = delete;
+    // All readers should be destroyed before the store.
+    ~SnapshotStore();
+
+    // Writers are serialized with each other, never with readers.
+    void Publish(std::unique_ptr<const Snapshot> snapshot);
+
+    // Deletes the replaced snapshots no reader can hold any more, returns the number of those kept.
+    size_t Reclaim();
+
+private:
+    static constexpr uint64_t IDLE = 0;
+
+    struct alignas(64) ReaderSlot {
+        std::atomic<bool> taken{false};
+        // The epoch a reader started in, IDLE between its guards.
+        std::atomic<uint64_t> epoch{IDLE};
+    };
+
+    size_t ReclaimLocked();
+
+    std::atomic<const Snapshot*> current_;
+    std::atomic<uint64_t> epoch_{1};
+    std::array<ReaderSlot, MAX_READERS> readers_;
+    std::mutex writer_mutex_;
+    // A replaced snapshot with the epoch from which readers cannot load it.
+    std::vector<std::pair<uint64_t, std::unique_ptr<const Snapshot>>> retired_;
+};
+
+} // snapshot
@@ -0,0 +1,177 @@
+// Stress test of snapshot publishing: reader threads answer routes from the current snapshot while
+// a writer publishes new ones. Every reader checks that versions never go back and that a probe route
+// costs what the version it got says. The snapshots are built before the timed phases, so these
+// measure the readers against Publish and reclamation alone, at one publish per PUBLISH_INTERVAL.
+// Exits with 1 on a wrong answer, a snapshot left unreclaimed or a p99 latency with publishing over
+// max_p99_ratio times the one without.
+//
+// From transport-catalogue/. Under -fsanitize=address a snapshot deleted while a reader holds it
+// fails the run, -fsanitize=thread checks the publishing for data races:
+//   g++ -std=c++17 -O2 -pthread -fsanitize=thread -I. stress/snapshot_stress.cpp $(ls *.cpp | grep -v main.cpp) -o snapshot_stress
+//   ./snapshot_stress [reader_count] [seconds_per_phase] [max_p99_ratio]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "snapshot.h"
+
+using namespace std;
+using Clock = chrono::steady_clock;
+
+namespace {
+
+constexpr int GRID_SIDE = 20;
+constexpr auto PUBLISH_INTERVAL = chrono::milliseconds(10);
+
+string StopName(int row, int column) {
+    return "Stop "s + to_string(row) + " "s + to_string(column);
+}
+
+// A grid of stops with a bus along every row and every column. Odd versions have longer rows,
+// so the probe route from corner to corner costs differently in them.
+unique_ptr<snapshot::Snapshot> BuildSnapshot(uint64_t version) {
+    auto result = make_unique<snapshot::Snapshot>();
+    result->version = version;
+    transport_catalogue::TransportCatalogue& catalogue = result->catalogue;
+    for (int row = 0; row < GRID_SIDE; ++row) {
+        for (int column = 0; column < GRID_SIDE; ++column) {
+            catalogue.AddStop(StopName(row, column), {55.5 + row * 0.01, 37.5 + column * 0.01});
+        }
+    }
+    const int row_distance = version % 2 ? 1500 : 1000;
+    for (int row = 0; row < GRID_SIDE; ++row) {
+        for (int column = 0; column + 1 < GRID_SIDE; ++column) {
+            catalogue.AddDistances(StopName(row, column), StopName(row, column + 1), row_distance);
+            catalogue.AddDistances(StopName(column, row), StopName(column + 1, row), 1200);
+        }
+    }
+    for (int line = 0; line < GRID_SIDE; ++line) {
+        vector<string> row_stops;
+        vector<string> column_stops;
+        for (int i = 0; i < GRID_SIDE; ++i) {
+            row_stops.push_back(StopName(line, i));
+            column_stops.push_back(StopName(i, line));
+        }
+        for (const auto& [name, stops] : {pair{"R"s + to_string(line), &row_stops}, pair{"C"s + to_string(line), &column_stops}}) {
+            vector<string_view> route(stops->begin(), stops->end());
+            route.insert(route.end(), stops->rbegin() + 1, stops->rend());
+            catalogue.AddBus(name, route, false);
+        }
+    }
+    catalogue.AddRoutingSettings(40., 6);
+    catalogue.CreateGraph();
+    result->router_settings.type = transport_router::RouterType::DIJKSTRA;
+    result->router.emplace(catalogue.GetGraph(), result->router_settings);
+    return result;
+}
+
+double Percentile(const vector<double>& sorted, double fraction) {
+    return sorted.empty() ? 0. : sorted[min(sorted.size() - 1, static_cast<size_t>(fraction * sorted.size()))];
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const int reader_count = argc > 1 ? max(1, atoi(argv[1])) : 4;
+    const double seconds = argc > 2 ? atof(argv[2]) : 2.;
+    const double max_p99_ratio = argc > 3 ? atof(argv[3]) : 2.;
+
+    const string probe_from = StopName(0, 0);
+    const string probe_to = StopName(GRID_SIDE - 1, GRID_SIDE - 1);
+    double expected[2];
+    for (const uint64_t parity : {0, 1}) {
+        const auto probe = BuildSnapshot(parity);
+        expected[parity] = probe->catalogue.GetRouteInfo(probe_from, probe_to, *probe->router)->all_time;
+    }
+
+    snapshot::SnapshotStore store(BuildSnapshot(0));
+    uint64_t version = 0;
+    size_t errors = 0;
+    double p99s[2] = {0., 0.};
+    for (const bool publishing : {false, true}) {
+        vector<unique_ptr<snapshot::Snapshot>> snapshots;
+        if (publishing) {
+            const auto publish_count = static_cast<size_t>(chrono::duration<double>(seconds) / PUBLISH_INTERVAL) + 1;
+            for (size_t i = 0; i < publish_count; ++i) {
+                snapshots.push_back(BuildSnapshot(++version));
+            }
+        }
+
+        atomic<bool> stop{false};
+        atomic<size_t> phase_errors{0};
+        vector<vector<double>> latencies(reader_count);
+        vector<thread> readers;
+        for (int index = 0; index < reader_count; ++index) {
+            readers.emplace_back([&, index] {
+                snapshot::SnapshotStore::Reader reader(store);
+                mt19937 random(index + 1);
+                uint64_t last_version = 0;
+                for (size_t query = 0; !stop; ++query) {
+                    const auto start = Clock::now();
+                    const auto guard = reader.Acquire();
+                    if (guard->version < last_version) {
+                        ++phase_errors;
+                    }
+                    last_version = guard->version;
+                    if (query % 16 == 0) {
+                        const auto info = guard->catalogue.GetRouteInfo(probe_from, probe_to, *guard->router);
+                        if (!info || info->all_time != expected[guard->version % 2]) {
+                            ++phase_errors;
+                        }
+                    }
+                    else {
+                        const string from = StopName(random() % GRID_SIDE, random() % GRID_SIDE);
+                        const string to = StopName(random() % GRID_SIDE, random() % GRID_SIDE);
+                        guard->catalogue.GetRouteInfo(from, to, *guard->router);
+                    }
+                    latencies[index].push_back(chrono::duration<double, micro>(Clock::now() - start).count());
+                }
+            });
+        }
+
+        size_t publish_count = 0;
+        size_t retired_max = 0;
+        const auto end = Clock::now() + chrono::duration<double>(seconds);
+        while (Clock::now() < end) {
+            this_thread::sleep_for(PUBLISH_INTERVAL);
+            if (publish_count < snapshots.size()) {
+                store.Publish(move(snapshots[publish_count++]));
+                retired_max = max(retired_max, store.Reclaim());
+            }
+        }
+        stop = true;
+        for (thread& reader : readers) {
+            reader.join();
+        }
+
+        vector<double> all;
+        for (const vector<double>& reader_latencies : latencies) {
+            all.insert(all.end(), reader_latencies.begin(), reader_latencies.end());
+        }
+        sort(all.begin(), all.end());
+        p99s[publishing] = Percentile(all, 0.99);
+        cout << (publishing ? "publishing:   "s : "readers only: "s) << all.size() << " queries, us p50 "s
+             << Percentile(all, 0.5) << " p99 "s << p99s[publishing] << " p99.9 "s << Percentile(all, 0.999)
+             << " max "s << (all.empty() ? 0. : all.back()) << ", "s << publish_count << " publishes, up to "s
+             << retired_max << " retired kept, "s << phase_errors << " errors"s << endl;
+        errors += phase_errors;
+    }
+
+    const size_t retired_left = store.Reclaim();
+    if (retired_left != 0) {
+        cout << retired_left << " retired snapshots left without readers"s << endl;
+    }
+    const bool flat = p99s[true] <= max_p99_ratio * p99s[false];
+    if (!flat) {
+        cout << "p99 with publishing is over "s << max_p99_ratio << " times the one without"s << endl;
+    }
+    return errors == 0 && retired_left == 0 && flat ? 0 : 1;
+}
@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+#include "string_pool.h"
+
+namespace string_pool {
+
+SymbolId StringPool::Intern(std::string_view str) {
+    const size_t hash = std::hash<std::string_view>{}(str);
+    if (!slots_.empty()) {
+        const size_t slot = FindSlot(str, hash);
+        if (slots_[slot] != EMPTY) {
+            return slots_[slot];
+        }
+    }
+    if (strings_.size() >= EMPTY) {
+        throw std::length_error("Too many strings for 32-bit symbol ids");
+    }
+    if (2 * (strings_.size() + 1) > slots_.size()) {
+        Rehash(std::max<size_t>(16, 2 * slots_.size()));
+    }
+
+    if (blocks_.empty() || block_used_ + str.size() > block_size_) {
+        block_size_ = std::max(BLOCK_SIZE, str.size());
+        blocks_.push_back(std::make_unique<char[]>(block_size_));
+        block_used_ = 0;
+    }
+    char* data = blocks_.back().get() + block_used_;
+    std::memcpy(data, str.data(), str.size());
+    block_used_ += str.size();
+
+    const SymbolId id = static_cast<SymbolId>(strings_.size());
+    strings_.emplace_back(data, str.size());
+    hashes_.push_back(hash);
+    slots_[FindSlot(str, hash)] = id;
+    return id;
+}
+
+std::optional<SymbolId> StringPool::Find(std::string_view str) const {
+    if (slots_.empty()) {
+        return std::nullopt;
+    }
+    const SymbolId id = slots_[FindSlot(str, std::hash<std::string_view>{}(str))];
+    if (id == EMPTY) {
+        return std::nullopt;
+    }
+    return id;
+}
+
+memory_usage::Usage StringPool::GetMemoryUsage() const {
+    // A string longer than a block got a block of its own size.
+    size_t long_string_count = 0;
+    memory_usage::Usage usage;
+    for (std::string_view str : strings_) {
+        if (str.size() > BLOCK_SIZE) {
+            usage.AddAllocation(str.size());
+            ++long_string_count;
+        }
+    }
+    usage.AddAllocations(BLOCK_SIZE, blocks_.size() - long_string_count);
+    usage += memory_usage::Measure(blocks_);
+    usage += memory_usage::Measure(strings_);
+    usage += memory_usage::Measure(hashes_);
+    usage += memory_usage::Measure(slots_);
+    return usage;
+}
+
+size_t StringPool::FindSlot(std::string_view str, size_t hash) const {
+    const size_t mask = slots_.size() - 1;
+    for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+        const SymbolId id = slots_[slot];
+        if (id == EMPTY || (hashes_[id] == hash && strings_[id] == str)) {
+            return slot;
+        }
+    }
+}
+
+void StringPool::Rehash(size_t slot_count) {
+    slots_.assign(slot_count, EMPTY);
+    const size_t mask = slot_count - 1;
+    for (SymbolId id = 0; id < strings_.size(); ++id) {
+        size_t slot = hashes_[id] & mask;
+        while (slots_[slot] != EMPTY) {
+            slot = (slot + 1) & mask;
+        }
+        slots_[slot] = id;
+    }
+}
+
+} // string_pool
@@ -0,0 +1,151 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "memory_usage.h"
+
+namespace string_pool {
+
+using SymbolId = uint32_t;
+
+// Keeps every interned string once, packed into large blocks, and numbers them 0, 1, 2...
+// Views returned by Get stay valid as long as the pool lives, moving it included.
+class StringPool {
+public:
+    StringPool() = default;
+    StringPool(const StringPool&) = delete;
+    StringPool& operator=(const StringPool&) = delete;
+    StringPool(StringPool&&) = default;
+    StringPool& operator=(StringPool&&) = default;
+
+    // Returns the id of a stored equal string or stores a copy of str.
+    SymbolId Intern(std::string_view str);
+
+    std::optional<SymbolId> Find(std::string_view str) const;
+
+    std::string_view Get(SymbolId id) const {
+        return strings_[id];
+    }
+
+    size_t GetSize() const {
+        return strings_.size();
+    }
+
+    memory_usage::Usage GetMemoryUsage() const;
+
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+    static constexpr SymbolId EMPTY = UINT32_MAX;
+
+    size_t FindSlot(std::string_view str, size_t hash) const;
+    void Rehash(size_t slot_count);
+
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    size_t block_size_ = 0;
+    size_t block_used_ = 0;
+    std::vector<std::string_view> strings_;
+    std::vector<size_t> hashes_;
+    // Open addressing with linear probing, the number of slots is a power of two.
+    std::vector<SymbolId> slots_;
+};
+
+// Maps strings fixed at construction to values. A slot keeps the hash, the string and the value
+// together, and at most half of the slots are taken, so a lookup mostly reads one slot and the string.
+// The strings are not copied and should outlive the index.
+template <typename Value>
+class FrozenIndex {
+public:
+    FrozenIndex() = default;
+
+    // Of equal strings the first one is kept.
+    explicit FrozenIndex(const std::vector<std::pair<std::string_view, Value>>& items);
+
+    const Value* Find(std::string_view str) const;
+
+    // Sets the value of a string, adding the string if it is new. Returns false and changes nothing
+    // when a new string would fill more than half of the slots, the index should be rebuilt then.
+    bool Assign(std::string_view str, Value value);
+
+    memory_usage::Usage GetMemoryUsage() const {
+        return memory_usage::Measure(slots_);
+    }
+
+private:
+    struct Slot {
+        size_t hash = 0;
+        // nullptr for a free slot.
+        const char* data = nullptr;
+        size_t size = 0;
+        Value value{};
+    };
+
+    size_t FindSlot(std::string_view str, size_t hash) const;
+
+    std::vector<Slot> slots_;
+    size_t size_ = 0;
+};
+
+template <typename Value>
+FrozenIndex<Value>::FrozenIndex(const std::vector<std::pair<std::string_view, Value>>& items) {
+    size_t slot_count = 16;
+    while (slot_count < 2 * items.size()) {
+        slot_count *= 2;
+    }
+    slots_.resize(slot_count);
+    for (const auto& [str, value] : items) {
+        const size_t hash = std::hash<std::string_view>{}(str);
+        Slot& slot = slots_[FindSlot(str, hash)];
+        if (!slot.data) {
+            slot = {hash, str.data() ? str.data() : "", str.size(), value};
+            ++size_;
+        }
+    }
+}
+
+template <typename Value>
+bool FrozenIndex<Value>::Assign(std::string_view str, Value value) {
+    if (slots_.empty()) {
+        return false;
+    }
+    const size_t hash = std::hash<std::string_view>{}(str);
+    Slot& slot = slots_[FindSlot(str, hash)];
+    if (!slot.data) {
+        if (2 * (size_ + 1) > slots_.size()) {
+            return false;
+        }
+        slot = {hash, str.data() ? str.data() : "", str.size(), value};
+        ++size_;
+        return true;
+    }
+    slot.value = std::move(value);
+    return true;
+}
+
+template <typename Value>
+const Value* FrozenIndex<Value>::Find(std::string_view str) const {
+    if (slots_.empty()) {
+        return nullptr;
+    }
+    const Slot& slot = slots_[FindSlot(str, std::hash<std::string_view>{}(str))];
+    return slot.data ? &slot.value : nullptr;
+}
+
+template <typename Value>
+size_t FrozenIndex<Value>::FindSlot(std::string_view str, size_t hash) const {
+    const size_t mask = slots_.size() - 1;
+    for (size_t index = hash & mask;; index = (index + 1) & mask) {
+        const Slot& slot = slots_[index];
+        if (!slot.data || (slot.hash == hash && slot.size == str.size()
+                           && (str.empty() || std::memcmp(slot.data, str.data(), str.size()) == 0))) {
+            return index;
+        }
+    }
+}
+
+} // string_pool
@@ -0,0 +1,36 @@
+#include <atomic>
+#include <cstdint>
+#include <random>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "temp_file.h"
+
+namespace temp_file {
+
+namespace {
+
+uint64_t GetProcessId() {
+#ifdef _WIN32
+    return static_cast<uint64_t>(_getpid());
+#else
+    return static_cast<uint64_t>(getpid());
+#endif
+}
+
+}
+
+std::string MakeTempPath(const std::string& path) {
+    using namespace std::literals::string_literals;
+    // random_device may be deterministic, the counter keeps the calls of one process apart then.
+    static std::atomic<uint64_t> call_count{0};
+    std::random_device random;
+    const uint64_t suffix = (static_cast<uint64_t>(random()) << 32 | random()) ^ call_count++;
+    return path + "."s + std::to_string(GetProcessId()) + "."s + std::to_string(suffix) + ".tmp"s;
+}
+
+} // temp_file
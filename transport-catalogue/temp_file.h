@@ -0,0 +1,40 @@
+#pragma once
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+namespace temp_file {
+
+// A name next to path, in the same directory so that renaming it to path is atomic, that no other
+// process and no other call picks: it has the process id and a random suffix.
+std::string MakeTempPath(const std::string& path);
+
+// write(output) fills a temporary file, which then replaces path, so readers never see a partial
+// file and writers racing for the same path never share one. On a failed write std::runtime_error
+// naming what was written is thrown, a failed rename throws std::filesystem::filesystem_error;
+// the temporary file is removed and path is left as it was in both cases.
+template <typename Write>
+void WriteReplacing(const std::string& path, const std::string& what, Write write) {
+    using namespace std::literals::string_literals;
+    const std::string temp_path = MakeTempPath(path);
+    try {
+        {
+            std::ofstream output(temp_path, std::ios::binary | std::ios::trunc);
+            write(output);
+            output.close();
+            if (!output) {
+                throw std::runtime_error("Failed to write "s + what + " to "s + temp_path);
+            }
+        }
+        std::filesystem::rename(temp_path, path);
+    }
+    catch (...) {
+        std::error_code ignored;
+        std::filesystem::remove(temp_path, ignored);
+        throw;
+    }
+}
+
+} // temp_file
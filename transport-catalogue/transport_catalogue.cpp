@@ -1,161 +1,853 @@
-#include <unordered_set>
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
 #include <utility>
 #include <vector>
 
+#include "distance_table.h"
+#include "parallel.h"
 #include "transport_catalogue.h"
+#include "vertex_order.h"
 
 namespace transport_catalogue {
 
-void TransportCatalogue::AddStop(const std::string& name, geo::Coordinates coordinates) {
-	stops_.push_back({ name, coordinates });
-	stopname_to_stop_[stops_.back().name] = &stops_.back();
+void TransportCatalogue::AddStop(std::string_view name, geo::Coordinates coordinates) {
+	++generation_;
+	const string_pool::SymbolId name_id = names_.Intern(name);
+	stops_.push_back({ names_.Get(name_id), coordinates, name_id, static_cast<StopId>(stops_.size()) });
+	symbol_to_stop_.resize(names_.GetSize(), nullptr);
+	symbol_to_stop_[name_id] = &stops_.back();
+	stop_buses_.emplace_back();
+	if (!finalized_) {
+		return;
+	}
+	stop_points_.Add(coordinates);
+	SetNameEntry(name_id);
+	if (graph_created_) {
+		const graph::VertexId vertex = graph_.GetVertexCount();
+		graph_.AddVertices(2);
+		stop_vertices_.push_back({ vertex, vertex + 1 });
+		graph::Edge<double> edge;
+		edge.from = vertex;
+		edge.to = vertex + 1;
+		edge.weight = ComputeEdgeTime(0, 0);
+		const graph::EdgeId edge_id = graph_.UpdateEdges({}, { edge }).front();
+		graph_.GetEdgePayload(edge_id) = { edge.weight, name_id, 0 };
+		ride_lengths_.push_back(0);
+	}
 }
 
 void TransportCatalogue::AddDistances(std::string_view main_name, std::string_view neighbour_name, int distance) {
-	Stop* main_stop = stopname_to_stop_.at(main_name);
-	Stop* neighbour_stop = stopname_to_stop_.at(neighbour_name);
-	distance_between_stops_[{main_stop, neighbour_stop}] = distance;
-	if (distance_between_stops_.count({ neighbour_stop, main_stop }) == 0) {
-		distance_between_stops_[{neighbour_stop, main_stop}] = distance;
+	AddDistances(GetStop(main_name)->id, GetStop(neighbour_name)->id, distance);
+}
+
+void TransportCatalogue::AddDistances(StopId main_id, StopId neighbour_id, int distance) {
+	++generation_;
+	Stop* main_stop = GetStop(main_id);
+	Stop* neighbour_stop = GetStop(neighbour_id);
+	distance_between_stops_[GetStopPairKey(main_stop->id, neighbour_stop->id)] = distance;
+	distance_between_stops_.emplace(GetStopPairKey(neighbour_stop->id, main_stop->id), distance);
+	if (!finalized_) {
+		return;
+	}
+	std::vector<BusId> buses;
+	const std::vector<BusId>& main_buses = stop_buses_[main_stop->id];
+	const std::vector<BusId>& neighbour_buses = stop_buses_[neighbour_stop->id];
+	std::set_intersection(main_buses.begin(), main_buses.end(), neighbour_buses.begin(), neighbour_buses.end(),
+		std::back_inserter(buses));
+	std::vector<StopId> from_stops;
+	for (const BusId bus : buses) {
+		bool changed = false;
+		for (size_t i = route_begins_[bus] + 1; i < route_ends_[bus]; ++i) {
+			const int hop_distance = FindDistance(route_stops_[i - 1], route_stops_[i]);
+			changed = changed || hop_distance != route_distances_[i];
+			route_distances_[i] = hop_distance;
+		}
+		if (changed) {
+			bus_infos_[bus] = ComputeBusInfo(bus);
+			from_stops.insert(from_stops.end(), route_stops_.begin() + route_begins_[bus], route_stops_.begin() + route_ends_[bus]);
+		}
+	}
+	if (graph_created_) {
+		std::sort(from_stops.begin(), from_stops.end());
+		from_stops.erase(std::unique(from_stops.begin(), from_stops.end()), from_stops.end());
+		UpdateRideEdges(from_stops);
+	}
+}
+
+void TransportCatalogue::AddBus(std::string_view name, const std::vector<std::string_view>& str_route, bool ring) {
+	std::vector<StopId> route_ids(str_route.size());
+	for (size_t i = 0; i < route_ids.size(); ++i) {
+		route_ids[i] = GetStop(str_route[i])->id;
 	}
+	AddBus(name, route_ids, ring);
 }
 
-void TransportCatalogue::AddBus(const std::string& name, const std::vector<std::string_view>& str_route, bool ring) {
+void TransportCatalogue::AddBus(std::string_view name, const std::vector<StopId>& route_ids, bool ring) {
+	++generation_;
+	std::vector<Stop*> route(route_ids.size());
+	for (size_t i = 0; i < route.size(); ++i) {
+		route[i] = GetStop(route_ids[i]);
+	}
+	if (graph_created_) {
+		CheckRouteDistances(route);
+	}
+	const string_pool::SymbolId name_id = names_.Intern(name);
+	buses_.push_back({ names_.Get(name_id), std::move(route), ring, name_id, static_cast<BusId>(buses_.size()) });
+	symbol_to_bus_.resize(names_.GetSize(), nullptr);
+	symbol_to_bus_[name_id] = &buses_.back();
+	LinkStopsToBus(buses_.back());
+	if (!finalized_) {
+		return;
+	}
+	const BusId bus = buses_.back().id;
+	route_begins_.push_back(route_stops_.size());
+	route_ends_.push_back(route_stops_.size());
+	bus_infos_.emplace_back();
+	UpdateRouteSlice(bus);
+	SetNameEntry(name_id);
+	if (graph_created_) {
+		UpdateRideEdges(GetRouteStops(buses_.back()));
+	}
+}
+
+void TransportCatalogue::RemoveBus(std::string_view name) {
+	++generation_;
+	Bus* bus = GetBus(name);
+	const BusId id = bus->id;
+	const BusId last = static_cast<BusId>(buses_.size() - 1);
+	std::vector<StopId> from_stops = GetRouteStops(*bus);
+	UnlinkStopsFromBus(*bus);
+	symbol_to_bus_[bus->name_id] = nullptr;
+	if (finalized_) {
+		SetNameEntry(bus->name_id);
+		stale_route_size_ += route_ends_[id] - route_begins_[id];
+	}
+	if (id != last) {
+		// The last bus takes the freed id. Ride edges out of its stops are generated again too:
+		// among equal ones the bus with the smallest id gives its name, like CreateGraph does.
+		Bus& moved = buses_.back();
+		const std::vector<StopId> moved_stops = GetRouteStops(moved);
+		UnlinkStopsFromBus(moved);
+		*bus = std::move(moved);
+		bus->id = id;
+		symbol_to_bus_[bus->name_id] = bus;
+		LinkStopsToBus(*bus);
+		if (finalized_) {
+			SetNameEntry(bus->name_id);
+			route_begins_[id] = route_begins_[last];
+			route_ends_[id] = route_ends_[last];
+			bus_infos_[id] = bus_infos_[last];
+		}
+		std::vector<StopId> stops;
+		std::set_union(from_stops.begin(), from_stops.end(), moved_stops.begin(), moved_stops.end(), std::back_inserter(stops));
+		from_stops = std::move(stops);
+	}
+	buses_.pop_back();
+	if (!finalized_) {
+		return;
+	}
+	route_begins_.pop_back();
+	route_ends_.pop_back();
+	bus_infos_.pop_back();
+	if (2 * stale_route_size_ > route_stops_.size()) {
+		LayOutRoutes();
+	}
+	if (graph_created_) {
+		UpdateRideEdges(from_stops);
+	}
+}
+
+void TransportCatalogue::UpdateBusRoute(std::string_view name, const std::vector<std::string_view>& str_route, bool ring) {
+	++generation_;
+	Bus* bus = GetBus(name);
 	std::vector<Stop*> route(str_route.size());
-	for (int i = 0; i < static_cast<int>(route.size()); ++i) {
-		route[i] = stopname_to_stop_.at(str_route[i]);
+	for (size_t i = 0; i < route.size(); ++i) {
+		route[i] = GetStop(str_route[i]);
+	}
+	if (graph_created_) {
+		CheckRouteDistances(route);
+	}
+	const std::vector<StopId> old_stops = GetRouteStops(*bus);
+	UnlinkStopsFromBus(*bus);
+	bus->route = std::move(route);
+	bus->ring = ring;
+	LinkStopsToBus(*bus);
+	if (!finalized_) {
+		return;
+	}
+	UpdateRouteSlice(bus->id);
+	if (graph_created_) {
+		const std::vector<StopId> new_stops = GetRouteStops(*bus);
+		std::vector<StopId> from_stops;
+		std::set_union(old_stops.begin(), old_stops.end(), new_stops.begin(), new_stops.end(), std::back_inserter(from_stops));
+		UpdateRideEdges(from_stops);
+	}
+}
+
+std::vector<StopId> TransportCatalogue::GetRouteStops(const Bus& bus) {
+	std::vector<StopId> result;
+	result.reserve(bus.route.size());
+	for (const Stop* stop : bus.route) {
+		result.push_back(stop->id);
+	}
+	std::sort(result.begin(), result.end());
+	result.erase(std::unique(result.begin(), result.end()), result.end());
+	return result;
+}
+
+void TransportCatalogue::LinkStopsToBus(const Bus& bus) {
+	for (const StopId stop : GetRouteStops(bus)) {
+		std::vector<BusId>& buses = stop_buses_[stop];
+		buses.insert(std::lower_bound(buses.begin(), buses.end(), bus.id), bus.id);
+	}
+}
+
+void TransportCatalogue::UnlinkStopsFromBus(const Bus& bus) {
+	for (const StopId stop : GetRouteStops(bus)) {
+		std::vector<BusId>& buses = stop_buses_[stop];
+		buses.erase(std::lower_bound(buses.begin(), buses.end(), bus.id));
+	}
+}
+
+void TransportCatalogue::Finalize(size_t thread_count) {
+	std::vector<geo::Coordinates> coordinates;
+	coordinates.reserve(stops_.size());
+	for (const Stop& stop : stops_) {
+		coordinates.push_back(stop.coordinates);
+	}
+	stop_points_ = geo::PointSet(coordinates);
+	LayOutRoutes();
+	BuildNameIndex();
+	bus_infos_.assign(buses_.size(), std::nullopt);
+	parallel::ParallelFor(buses_.size(), thread_count, [this](size_t bus) {
+		bus_infos_[bus] = ComputeBusInfo(static_cast<BusId>(bus));
+	});
+	finalized_ = true;
+}
+
+void TransportCatalogue::LayOutRoutes() {
+	route_begins_.clear();
+	route_ends_.clear();
+	route_begins_.reserve(buses_.size());
+	route_ends_.reserve(buses_.size());
+	route_stops_.clear();
+	route_distances_.clear();
+	for (const Bus& bus : buses_) {
+		route_begins_.push_back(route_stops_.size());
+		for (size_t i = 0; i < bus.route.size(); ++i) {
+			route_stops_.push_back(bus.route[i]->id);
+			route_distances_.push_back(i == 0 ? 0 : FindDistance(bus.route[i - 1]->id, bus.route[i]->id));
+		}
+		route_ends_.push_back(route_stops_.size());
+	}
+	stale_route_size_ = 0;
+}
+
+void TransportCatalogue::UpdateRouteSlice(BusId bus) {
+	stale_route_size_ += route_ends_[bus] - route_begins_[bus];
+	if (2 * stale_route_size_ > route_stops_.size()) {
+		LayOutRoutes();
+	}
+	else {
+		const std::vector<Stop*>& route = buses_[bus].route;
+		route_begins_[bus] = route_stops_.size();
+		for (size_t i = 0; i < route.size(); ++i) {
+			route_stops_.push_back(route[i]->id);
+			route_distances_.push_back(i == 0 ? 0 : FindDistance(route[i - 1]->id, route[i]->id));
+		}
+		route_ends_[bus] = route_stops_.size();
+	}
+	bus_infos_[bus] = ComputeBusInfo(bus);
+}
+
+void TransportCatalogue::BuildNameIndex() {
+	std::vector<std::pair<std::string_view, NameEntry>> names;
+	names.reserve(names_.GetSize());
+	for (string_pool::SymbolId name_id = 0; name_id < names_.GetSize(); ++name_id) {
+		NameEntry entry;
+		entry.stop = name_id < symbol_to_stop_.size() ? symbol_to_stop_[name_id] : nullptr;
+		entry.bus = name_id < symbol_to_bus_.size() ? symbol_to_bus_[name_id] : nullptr;
+		names.emplace_back(names_.Get(name_id), entry);
+	}
+	name_index_ = string_pool::FrozenIndex<NameEntry>(names);
+}
+
+void TransportCatalogue::SetNameEntry(string_pool::SymbolId name_id) {
+	NameEntry entry;
+	entry.stop = name_id < symbol_to_stop_.size() ? symbol_to_stop_[name_id] : nullptr;
+	entry.bus = name_id < symbol_to_bus_.size() ? symbol_to_bus_[name_id] : nullptr;
+	if (!name_index_.Assign(names_.Get(name_id), entry)) {
+		BuildNameIndex();
 	}
-	buses_.push_back({ name, std::move(route) , ring });
-	busname_to_bus_[buses_.back().name] = &buses_.back();
-	for (auto stop : str_route) {
-		stop_to_busnames_[stopname_to_stop_.at(stop)].insert(busname_to_bus_.at(name)->name);
+}
+
+std::optional<TransportCatalogue::BusInfo> TransportCatalogue::ComputeBusInfo(BusId bus) const {
+	const size_t begin = route_begins_[bus];
+	const size_t end = route_ends_[bus];
+	const size_t count_all_stops = end - begin;
+
+	std::vector<StopId> unique_stops(route_stops_.begin() + begin, route_stops_.begin() + end);
+	std::sort(unique_stops.begin(), unique_stops.end());
+	const size_t count_unique_stops = std::unique(unique_stops.begin(), unique_stops.end()) - unique_stops.begin();
+
+	int route_lenght = 0;
+	for (size_t i = begin + 1; i < end; ++i) {
+		if (route_distances_[i] == NO_DISTANCE) {
+			return std::nullopt;
+		}
+		route_lenght += route_distances_[i];
+	}
+	const double geo_route_lenght = stop_points_.ComputePathLength(route_stops_.data() + begin, count_all_stops);
+	return BusInfo{ count_all_stops, count_unique_stops, route_lenght, route_lenght / geo_route_lenght };
+}
+
+std::optional<TransportCatalogue::BusInfo> TransportCatalogue::ComputeBusInfo(const Bus& bus) const {
+	const std::vector<Stop*>& route = bus.route;
+	const size_t count_unique_stops = GetRouteStops(bus).size();
+
+	int route_lenght = 0;
+	for (size_t i = 1; i < route.size(); ++i) {
+		const int distance = FindDistance(route[i - 1]->id, route[i]->id);
+		if (distance == NO_DISTANCE) {
+			return std::nullopt;
+		}
+		route_lenght += distance;
+	}
+	// Measured like Finalize does, so the curvature does not change once the catalogue is finalized.
+	std::vector<geo::Coordinates> points;
+	points.reserve(route.size());
+	for (const Stop* stop : route) {
+		points.push_back(stop->coordinates);
+	}
+	std::vector<StopId> indices(route.size());
+	std::iota(indices.begin(), indices.end(), StopId{0});
+	const double geo_route_lenght = geo::PointSet(points).ComputePathLength(indices.data(), indices.size());
+	return BusInfo{ route.size(), count_unique_stops, route_lenght, route_lenght / geo_route_lenght };
+}
+
+int TransportCatalogue::FindDistance(StopId from, StopId to) const {
+	const auto it = distance_between_stops_.find(GetStopPairKey(from, to));
+	return it == distance_between_stops_.end() ? NO_DISTANCE : it->second;
+}
+
+int TransportCatalogue::CheckDistance(int distance) {
+	if (distance == NO_DISTANCE) {
+		throw std::out_of_range("No road distance between stops");
+	}
+	return distance;
+}
+
+void TransportCatalogue::CheckRouteDistances(const std::vector<Stop*>& route) const {
+	for (size_t i = 1; i < route.size(); ++i) {
+		CheckDistance(FindDistance(route[i - 1]->id, route[i]->id));
 	}
 }
 
 void TransportCatalogue::AddRoutingSettings(double bus_velocity, int bus_wait_time) {
+	++generation_;
 	bus_velocity_ = bus_velocity;
 	bus_wait_time_ = bus_wait_time;
+	ApplyRoutingSettings();
+}
+
+uint64_t TransportCatalogue::GetGeneration() const {
+	return generation_;
+}
+
+double TransportCatalogue::GetBusVelocity() const {
+	return bus_velocity_;
+}
+
+int TransportCatalogue::GetBusWaitTime() const {
+	return bus_wait_time_;
 }
 
 Bus* TransportCatalogue::FindBus(std::string_view name) const {
-	if (busname_to_bus_.count(name)) {
-		return busname_to_bus_.at(name);
+	if (finalized_) {
+		const NameEntry* entry = name_index_.Find(name);
+		return entry ? entry->bus : nullptr;
 	}
-	return nullptr;
+	const std::optional<string_pool::SymbolId> name_id = names_.Find(name);
+	return name_id && *name_id < symbol_to_bus_.size() ? symbol_to_bus_[*name_id] : nullptr;
 }
 
 Stop* TransportCatalogue::FindStop(std::string_view name) const {
-	if (stopname_to_stop_.count(name)) {
-		return stopname_to_stop_.at(name);
+	if (finalized_) {
+		const NameEntry* entry = name_index_.Find(name);
+		return entry ? entry->stop : nullptr;
 	}
-	return nullptr;
+	const std::optional<string_pool::SymbolId> name_id = names_.Find(name);
+	return name_id && *name_id < symbol_to_stop_.size() ? symbol_to_stop_[*name_id] : nullptr;
 }
 
-const std::deque<Bus>& TransportCatalogue::GetAllBuses() const {
-	return buses_;
+Stop* TransportCatalogue::GetStop(std::string_view name) const {
+	if (Stop* stop = FindStop(name)) {
+		return stop;
+	}
+	throw std::out_of_range("Unknown stop");
 }
 
-int TransportCatalogue::GetDistance(std::string_view main_name, std::string_view neighbour_name) const {
-	return distance_between_stops_.at({ stopname_to_stop_.at(main_name), stopname_to_stop_.at(neighbour_name) });
+Stop* TransportCatalogue::GetStop(StopId id) const {
+	if (id >= stops_.size()) {
+		throw std::out_of_range("Unknown stop");
+	}
+	return const_cast<Stop*>(&stops_[id]);
 }
 
-TransportCatalogue::BusInfo TransportCatalogue::GetBusInfo(std::string_view bus) const {
-	const size_t count_all_stops = busname_to_bus_.at(bus)->route.size();
+Bus* TransportCatalogue::GetBus(std::string_view name) const {
+	if (Bus* bus = FindBus(name)) {
+		return bus;
+	}
+	throw std::out_of_range("Unknown bus");
+}
 
-	const std::vector<Stop*>& route = busname_to_bus_.at(bus)->route;
-	const std::unordered_set<Stop*> unique_stops(route.begin(), route.end());
-	const size_t count_unique_stops = unique_stops.size();
+const TransportCatalogue::StopVertices& TransportCatalogue::GetStopVertices(std::string_view name) const {
+	const StopId stop_id = GetStop(name)->id;
+	if (!graph_created_ || stop_id >= stop_vertices_.size()) {
+		throw std::out_of_range("The graph is not created");
+	}
+	return stop_vertices_[stop_id];
+}
 
-	int route_lenght = 0;
-	for (int i = 1; i < static_cast<int>(route.size()); ++i) {
-		route_lenght += distance_between_stops_.at({ route[i - 1], route[i] });
+const std::deque<Stop>& TransportCatalogue::GetAllStops() const {
+	return stops_;
+}
+
+const std::deque<Bus>& TransportCatalogue::GetAllBuses() const {
+	return buses_;
+}
+
+std::vector<RoadDistance> TransportCatalogue::GetRoadDistances() const {
+	std::vector<RoadDistance> result;
+	result.reserve(distance_between_stops_.size());
+	for (const auto& [key, distance] : distance_between_stops_) {
+		result.push_back({ static_cast<StopId>(key >> 32), static_cast<StopId>(key), distance });
 	}
+	std::sort(result.begin(), result.end(), [](const RoadDistance& lhs, const RoadDistance& rhs) {
+		return std::pair{ lhs.from, lhs.to } < std::pair{ rhs.from, rhs.to };
+	});
+	return result;
+}
+
+int TransportCatalogue::GetDistance(std::string_view main_name, std::string_view neighbour_name) const {
+	return CheckDistance(FindDistance(GetStop(main_name)->id, GetStop(neighbour_name)->id));
+}
 
-	double geo_route_lenght = 0.;
-	for (int i = 1; i < static_cast<int>(route.size()); ++i) {
-		geo_route_lenght += geo::ComputeDistance(route[i - 1]->coordinates, route[i]->coordinates);
+TransportCatalogue::BusInfo TransportCatalogue::GetBusInfo(std::string_view bus) const {
+	const Bus* found_bus = GetBus(bus);
+	const std::optional<BusInfo> bus_info = finalized_ ? bus_infos_[found_bus->id] : ComputeBusInfo(*found_bus);
+	if (!bus_info) {
+		throw std::out_of_range("No road distance between stops");
 	}
-	return { count_all_stops, count_unique_stops, route_lenght, route_lenght / geo_route_lenght };
+	return *bus_info;
 }
 
 std::set<std::string_view> TransportCatalogue::GetBusesPassingThroughStop(std::string_view stop) const {
-	if (!stop_to_busnames_.count(stopname_to_stop_.at(stop))) {
-		return {};
+	std::set<std::string_view> result;
+	for (const BusId bus : stop_buses_[GetStop(stop)->id]) {
+		result.insert(buses_[bus].name);
 	}
-	return stop_to_busnames_.at(stopname_to_stop_.at(stop));
+	return result;
 }
 
-std::optional<RouteInfo> TransportCatalogue::GetRouteInfo(std::string_view from, std::string_view to, const graph::Router<double>& router) const {
+std::optional<RouteInfo> TransportCatalogue::GetRouteInfo(std::string_view from, std::string_view to, const transport_router::TransportRouter& router,
+	graph::SearchStats* stats) const {
 	using namespace std::literals::string_literals;
-	auto rout_info = router.BuildRoute(stopname_to_vertex_.at(from).first, stopname_to_vertex_.at(to).first);
+	if (const line_router::LineRouter* line_router = router.GetLineRouter()) {
+		return line_router->BuildRoute(GetStop(from), GetStop(to));
+	}
+	auto rout_info = router.BuildRoute(GetStopVertices(from).first, GetStopVertices(to).first, stats);
 	if (!rout_info.has_value()) {
 		return std::nullopt;
 	}
 	RouteInfo result;
 	result.all_time = rout_info->weight;
 	for (graph::EdgeId edge_id: rout_info->edges) {
-		result.edges.push_back(edge_id_to_edge_.at(static_cast<int>(edge_id)));
+		result.edges.push_back(GetEdgeInfo(edge_id));
+	}
+	return result;
+}
+
+std::vector<std::optional<double>> TransportCatalogue::GetTravelTimes(const std::vector<std::string_view>& from, const std::vector<std::string_view>& to, const transport_router::TransportRouter& router, size_t thread_count) const {
+	if (const line_router::LineRouter* line_router = router.GetLineRouter()) {
+		std::vector<const Stop*> to_stops;
+		for (std::string_view name : to) {
+			to_stops.push_back(GetStop(name));
+		}
+		std::vector<std::optional<double>> result(from.size() * to.size());
+		parallel::ParallelFor(from.size(), thread_count, [&](size_t i) {
+			const auto row = line_router->GetTravelTimes(GetStop(from[i]), to_stops);
+			std::copy(row.begin(), row.end(), result.begin() + i * to.size());
+		});
+		return result;
+	}
+	auto to_vertices = [this](const std::vector<std::string_view>& names) {
+		std::vector<graph::VertexId> vertices;
+		vertices.reserve(names.size());
+		for (std::string_view name : names) {
+			vertices.push_back(GetStopVertices(name).first);
+		}
+		return vertices;
+	};
+	const std::vector<double> table = graph::ComputeDistanceTable(graph_.GetGraph(), to_vertices(from), to_vertices(to), thread_count);
+	std::vector<std::optional<double>> result;
+	result.reserve(table.size());
+	for (double time : table) {
+		if (time == std::numeric_limits<double>::infinity()) {
+			result.push_back(std::nullopt);
+		}
+		else {
+			result.push_back(time);
+		}
 	}
 	return result;
 }
 
 const graph::DirectedWeightedGraph<double>& TransportCatalogue::GetGraph() const {
-	return graph_;
+	return graph_.GetGraph();
 }
 
-void TransportCatalogue::CreateGraph() {
-	graph_ = graph::DirectedWeightedGraph<double>(2 * stops_.size());
+EdgeInfo TransportCatalogue::GetEdgeInfo(graph::EdgeId edge_id) const {
+	const EdgePayload& payload = graph_.GetEdgePayload(edge_id);
+	return { names_.Get(payload.name_id), payload.time, payload.span_count };
+}
+
+void TransportCatalogue::CreateGraph(size_t thread_count, transport_router::VertexOrder vertex_order) {
+	graph_thread_count_ = thread_count;
+	vertex_order_ = vertex_order;
+	graph_ = graph::PayloadGraph<double, EdgePayload>(2 * stops_.size());
+	if (!finalized_) {
+		Finalize();
+	}
+	stop_vertices_.clear();
+	stop_vertices_.reserve(stops_.size());
+	ride_lengths_.clear();
 	graph::VertexId ind_vertex = 0;
 	for (const Stop& stop : stops_) {
-		stopname_to_vertex_[stop.name] = { ind_vertex, ind_vertex + 1 };
+		stop_vertices_.push_back({ ind_vertex, ind_vertex + 1 });
 		graph::Edge<double> edge;
 		edge.from = ind_vertex;
 		edge.to = ind_vertex + 1;
-		edge.weight = bus_wait_time_;
-		edge_id_to_edge_[static_cast<int>(graph_.AddEdge(edge))] = { stop.name, static_cast<double>(bus_wait_time_) };
+		edge.weight = 0.;
+		graph_.AddEdge(edge, { 0., stop.name_id, 0 });
+		ride_lengths_.push_back(0);
 		ind_vertex += 2;
 	}
-	for (const Bus& bus : buses_) {
-		if (bus.ring) {
-			for (int i = 0; i < static_cast<int>(bus.route.size()); ++i) {
-				int route_lenght = 0;
-				for (int j = i + 1; j < static_cast<int>(bus.route.size()); ++j) {
-					if (bus.route[i]->name == bus.route[j]->name) {
-						continue;
-					}
-					graph::Edge<double> edge;
-					edge.from = stopname_to_vertex_[bus.route[i]->name].second;
-					edge.to = stopname_to_vertex_[bus.route[j]->name].first;
-					route_lenght += distance_between_stops_.at({ bus.route[j - 1], bus.route[j] });
-					edge.weight = route_lenght / bus_velocity_ * 60. / 1000.;
-					edge_id_to_edge_[static_cast<int>(graph_.AddEdge(edge))] = { bus.name, edge.weight, j - i };
-				}
+
+	// Ride edges of every bus go to a buffer of its own and are added in the order of buses,
+	// so edge ids do not depend on the number of threads.
+	std::vector<std::vector<RideEdge>> ride_edges(buses_.size());
+	parallel::ParallelFor(buses_.size(), thread_count, [this, &ride_edges](size_t index) {
+		ride_edges[index] = CreateRideEdges(static_cast<BusId>(index));
+	});
+	size_t ride_edge_count = 0;
+	for (const std::vector<RideEdge>& edges : ride_edges) {
+		ride_edge_count += edges.size();
+	}
+	std::vector<RideEdge> all_ride_edges;
+	std::vector<string_pool::SymbolId> bus_names;
+	all_ride_edges.reserve(ride_edge_count);
+	bus_names.reserve(ride_edge_count);
+	for (size_t index = 0; index < buses_.size(); ++index) {
+		all_ride_edges.insert(all_ride_edges.end(), ride_edges[index].begin(), ride_edges[index].end());
+		bus_names.insert(bus_names.end(), ride_edges[index].size(), buses_[index].name_id);
+		ride_edges[index] = {};
+	}
+	const std::vector<size_t> chosen_edges = CollapseRideEdges(all_ride_edges, thread_count);
+	const size_t edge_count = graph_.GetEdgeCount() + chosen_edges.size()
+		- std::count(chosen_edges.begin(), chosen_edges.end(), NOT_CHOSEN);
+	graph_.ReserveEdges(edge_count);
+	ride_lengths_.reserve(edge_count);
+	for (size_t index = 0; index < all_ride_edges.size(); ++index) {
+		if (chosen_edges[index] == NOT_CHOSEN) {
+			continue;
+		}
+		const RideEdge& chosen = all_ride_edges[chosen_edges[index]];
+		graph_.AddEdge(all_ride_edges[index].edge, { 0., bus_names[chosen_edges[index]], chosen.span_count });
+		ride_lengths_.push_back(chosen.route_lenght);
+	}
+	if (vertex_order != transport_router::VertexOrder::INPUT) {
+		RenumberVertices(vertex_order);
+	}
+	graph_.Freeze();
+	free_edges_.clear();
+	graph_created_ = true;
+	ApplyRoutingSettings();
+}
+
+void TransportCatalogue::RenumberVertices(transport_router::VertexOrder vertex_order) {
+	// Both vertices of a stop keep being neighbours: the stop at position i gets 2 * i and 2 * i + 1.
+	std::vector<size_t> stop_order;
+	if (vertex_order == transport_router::VertexOrder::HILBERT) {
+		std::vector<geo::Coordinates> points;
+		points.reserve(stops_.size());
+		for (const Stop& stop : stops_) {
+			points.push_back(stop.coordinates);
+		}
+		stop_order = vertex_order::SpaceFillingCurveOrder(points);
+	}
+	else {
+		std::vector<std::vector<size_t>> adjacency(stops_.size());
+		for (graph::EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+			const graph::Edge<double>& edge = graph_.GetEdge(edge_id);
+			if (edge.from / 2 != edge.to / 2) {
+				adjacency[edge.from / 2].push_back(edge.to / 2);
+				adjacency[edge.to / 2].push_back(edge.from / 2);
 			}
 		}
-		else {
-			for (int i = 0; i < static_cast<int>(bus.route.size()) / 2; ++i) {
-				int route_lenght = 0;
-				for (int j = i + 1; j <= static_cast<int>(bus.route.size()) / 2; ++j) {
-					graph::Edge<double> edge;
-					edge.from = stopname_to_vertex_[bus.route[i]->name].second;
-					edge.to = stopname_to_vertex_[bus.route[j]->name].first;
-					route_lenght += distance_between_stops_.at({ bus.route[j-1], bus.route[j] });
-					edge.weight = route_lenght / bus_velocity_ * 60. / 1000.;
-					edge_id_to_edge_[static_cast<int>(graph_.AddEdge(edge))] = { bus.name, edge.weight, j - i };
-				}
+		for (std::vector<size_t>& neighbours : adjacency) {
+			std::sort(neighbours.begin(), neighbours.end());
+			neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+		}
+		stop_order = vertex_order::ReverseCuthillMcKeeOrder(adjacency);
+	}
+
+	std::vector<graph::VertexId> new_ids(graph_.GetVertexCount());
+	for (size_t position = 0; position < stop_order.size(); ++position) {
+		new_ids[2 * stop_order[position]] = 2 * position;
+		new_ids[2 * stop_order[position] + 1] = 2 * position + 1;
+	}
+	graph_.RenumberVertices(new_ids);
+	for (StopVertices& vertices : stop_vertices_) {
+		vertices = { new_ids[vertices.first], new_ids[vertices.second] };
+	}
+}
+
+std::vector<size_t> TransportCatalogue::CollapseRideEdges(const std::vector<RideEdge>& edges, size_t thread_count) const {
+	// Edges are grouped by the from vertex with a counting sort, each group is sorted by the rest of the key.
+	const size_t vertex_count = graph_.GetVertexCount();
+	std::vector<size_t> group_begins(vertex_count + 1, 0);
+	for (const RideEdge& ride_edge : edges) {
+		++group_begins[ride_edge.edge.from + 1];
+	}
+	for (size_t vertex = 0; vertex < vertex_count; ++vertex) {
+		group_begins[vertex + 1] += group_begins[vertex];
+	}
+	std::vector<size_t> grouped(edges.size());
+	std::vector<size_t> positions(group_begins.begin(), group_begins.end() - 1);
+	for (size_t index = 0; index < edges.size(); ++index) {
+		grouped[positions[edges[index].edge.from]++] = index;
+	}
+
+	std::vector<size_t> result(edges.size(), NOT_CHOSEN);
+	parallel::ParallelFor(vertex_count, thread_count, [&](size_t vertex) {
+		const auto begin = grouped.begin() + group_begins[vertex];
+		const auto end = grouped.begin() + group_begins[vertex + 1];
+		auto key = [&edges](size_t index) {
+			return std::tuple{ edges[index].edge.to, edges[index].span_count, edges[index].route_lenght, index };
+		};
+		std::sort(begin, end, [&key](size_t lhs, size_t rhs) {
+			return key(lhs) < key(rhs);
+		});
+		for (auto it = begin; it != end;) {
+			const auto same_key_end = std::find_if(it, end, [&](size_t index) {
+				return edges[index].edge.to != edges[*it].edge.to || edges[index].span_count != edges[*it].span_count;
+			});
+			result[*std::min_element(it, same_key_end)] = *it;
+			it = same_key_end;
+		}
+	});
+	return result;
+}
+
+std::vector<TransportCatalogue::RideEdge> TransportCatalogue::CreateRideEdges(BusId bus, std::optional<StopId> from) const {
+	const StopId* stops = route_stops_.data() + route_begins_[bus];
+	const int* distances = route_distances_.data() + route_begins_[bus];
+	const int stop_count = static_cast<int>(route_ends_[bus] - route_begins_[bus]);
+	for (int i = 1; i < stop_count; ++i) {
+		CheckDistance(distances[i]);
+	}
+
+	std::vector<RideEdge> result;
+	auto add_edges = [&](int begin, int end, bool ring) {
+		for (int i = begin; i < end; ++i) {
+			if (from && stops[i] != *from) {
+				continue;
 			}
-			for (int i = static_cast<int>(bus.route.size()) / 2; i < static_cast<int>(bus.route.size()); ++i) {
-				int route_lenght = 0;
-				for (int j = i + 1; j < static_cast<int>(bus.route.size()); ++j) {
-					graph::Edge<double> edge;
-					edge.from = stopname_to_vertex_[bus.route[i]->name].second;
-					edge.to = stopname_to_vertex_[bus.route[j]->name].first;
-					route_lenght += distance_between_stops_.at({ bus.route[j - 1], bus.route[j] });
-					edge.weight = route_lenght / bus_velocity_ * 60. / 1000.;
-					edge_id_to_edge_[static_cast<int>(graph_.AddEdge(edge))] = { bus.name, edge.weight, j - i };
+			int route_lenght = 0;
+			for (int j = i + 1; j < end; ++j) {
+				if (ring && stops[i] == stops[j]) {
+					continue;
 				}
+				route_lenght += distances[j];
+				graph::Edge<double> edge;
+				edge.from = stop_vertices_[stops[i]].second;
+				edge.to = stop_vertices_[stops[j]].first;
+				edge.weight = 0.;
+				result.push_back({ edge, route_lenght, j - i });
+			}
+		}
+	};
+	if (buses_[bus].ring) {
+		add_edges(0, stop_count, true);
+	}
+	else {
+		add_edges(0, stop_count / 2 + 1, false);
+		add_edges(stop_count / 2, stop_count, false);
+	}
+	return result;
+}
+
+void TransportCatalogue::UpdateRideEdges(const std::vector<StopId>& from_stops) {
+	std::vector<std::pair<graph::EdgeId, graph::Edge<double>>> updated;
+	std::vector<graph::Edge<double>> added;
+	// Payloads and lengths for updated and added, in their order. A reused edge still lies in the row
+	// of its old from vertex, so they are set after the graph is updated.
+	std::vector<std::pair<EdgePayload, int>> updated_payloads;
+	std::vector<std::pair<EdgePayload, int>> added_payloads;
+	std::vector<graph::EdgeId> dropped;
+	for (const StopId from : from_stops) {
+		std::vector<RideEdge> edges;
+		std::vector<string_pool::SymbolId> bus_names;
+		for (const BusId bus : stop_buses_[from]) {
+			const std::vector<RideEdge> bus_edges = CreateRideEdges(bus, from);
+			edges.insert(edges.end(), bus_edges.begin(), bus_edges.end());
+			bus_names.insert(bus_names.end(), bus_edges.size(), buses_[bus].name_id);
+		}
+		// The first edge of every key in this order is the one CollapseRideEdges chooses.
+		std::vector<size_t> order(edges.size());
+		for (size_t index = 0; index < order.size(); ++index) {
+			order[index] = index;
+		}
+		std::sort(order.begin(), order.end(), [&edges](size_t lhs, size_t rhs) {
+			return std::tuple{ edges[lhs].edge.to, edges[lhs].span_count, edges[lhs].route_lenght, lhs }
+				< std::tuple{ edges[rhs].edge.to, edges[rhs].span_count, edges[rhs].route_lenght, rhs };
+		});
+		const graph::VertexId from_vertex = stop_vertices_[from].second;
+		std::vector<graph::EdgeId> current;
+		for (const graph::EdgeId edge_id : graph_.GetIncidentEdges(from_vertex)) {
+			if (graph_.GetEdgePayload(edge_id).span_count > 0) {
+				current.push_back(edge_id);
 			}
 		}
+		auto current_key = [this](graph::EdgeId edge_id) {
+			return std::pair{ graph_.GetEdge(edge_id).to, graph_.GetEdgePayload(edge_id).span_count };
+		};
+		std::sort(current.begin(), current.end(), [&current_key](graph::EdgeId lhs, graph::EdgeId rhs) {
+			return current_key(lhs) < current_key(rhs);
+		});
+
+		// Edges with a key that stays keep their ids, the ones left over go to the new keys first.
+		std::vector<graph::EdgeId> unmatched;
+		std::vector<size_t> new_edges;
+		auto current_it = current.begin();
+		for (auto it = order.begin(); it != order.end();) {
+			const RideEdge& chosen = edges[*it];
+			const std::pair key{ chosen.edge.to, chosen.span_count };
+			for (; current_it != current.end() && current_key(*current_it) < key; ++current_it) {
+				unmatched.push_back(*current_it);
+			}
+			if (current_it != current.end() && current_key(*current_it) == key) {
+				const double weight = ComputeEdgeTime(chosen.span_count, chosen.route_lenght);
+				graph_.SetEdgeWeight(*current_it, weight);
+				graph_.GetEdgePayload(*current_it) = { weight, bus_names[*it], chosen.span_count };
+				ride_lengths_[*current_it] = chosen.route_lenght;
+				++current_it;
+			}
+			else {
+				new_edges.push_back(*it);
+			}
+			it = std::find_if(it, order.end(), [&](size_t index) {
+				return edges[index].edge.to != key.first || edges[index].span_count != key.second;
+			});
+		}
+		unmatched.insert(unmatched.end(), current_it, current.end());
+
+		for (const size_t index : new_edges) {
+			const RideEdge& chosen = edges[index];
+			graph::Edge<double> edge = chosen.edge;
+			edge.weight = ComputeEdgeTime(chosen.span_count, chosen.route_lenght);
+			const EdgePayload payload{ edge.weight, bus_names[index], chosen.span_count };
+			std::vector<graph::EdgeId>& reused = unmatched.empty() ? free_edges_ : unmatched;
+			if (reused.empty()) {
+				added.push_back(edge);
+				added_payloads.push_back({ payload, chosen.route_lenght });
+			}
+			else {
+				updated.push_back({ reused.back(), edge });
+				updated_payloads.push_back({ payload, chosen.route_lenght });
+				reused.pop_back();
+			}
+		}
+		for (const graph::EdgeId edge_id : unmatched) {
+			graph::Edge<double> edge;
+			edge.from = from_vertex;
+			edge.to = from_vertex;
+			edge.weight = ComputeEdgeTime(DEAD_SPAN_COUNT, 0);
+			updated.push_back({ edge_id, edge });
+			updated_payloads.push_back({ { edge.weight, graph_.GetEdgePayload(edge_id).name_id, DEAD_SPAN_COUNT }, 0 });
+			dropped.push_back(edge_id);
+		}
+	}
+	if (updated.empty() && added.empty()) {
+		return;
+	}
+	const std::vector<graph::EdgeId> added_ids = graph_.UpdateEdges(updated, added);
+	ride_lengths_.resize(graph_.GetEdgeCount());
+	auto set_payloads = [this](auto edge_id_at, const std::vector<std::pair<EdgePayload, int>>& payloads) {
+		for (size_t index = 0; index < payloads.size(); ++index) {
+			graph_.GetEdgePayload(edge_id_at(index)) = payloads[index].first;
+			ride_lengths_[edge_id_at(index)] = payloads[index].second;
+		}
+	};
+	set_payloads([&updated](size_t index) { return updated[index].first; }, updated_payloads);
+	set_payloads([&added_ids](size_t index) { return added_ids[index]; }, added_payloads);
+	free_edges_.insert(free_edges_.end(), dropped.begin(), dropped.end());
+	if (2 * free_edges_.size() > graph_.GetEdgeCount()) {
+		CreateGraph(graph_thread_count_, vertex_order_);
+	}
+}
+
+double TransportCatalogue::ComputeEdgeTime(int span_count, int route_lenght) const {
+	if (span_count == DEAD_SPAN_COUNT) {
+		return std::numeric_limits<double>::infinity();
+	}
+	return span_count == 0
+		? static_cast<double>(bus_wait_time_)
+		: route_lenght / bus_velocity_ * 60. / 1000.;
+}
+
+void TransportCatalogue::ApplyRoutingSettings() {
+	for (graph::EdgeId edge_id = 0; edge_id < graph_.GetEdgeCount(); ++edge_id) {
+		EdgePayload& payload = graph_.GetEdgePayload(edge_id);
+		const double weight = ComputeEdgeTime(payload.span_count, ride_lengths_[edge_id]);
+		graph_.SetEdgeWeight(edge_id, weight);
+		payload.time = weight;
+	}
+}
+
+memory_usage::Report TransportCatalogue::GetMemoryUsage() const {
+	using namespace std::literals::string_literals;
+	memory_usage::Usage bus_routes;
+	for (const Bus& bus : buses_) {
+		bus_routes += memory_usage::Measure(bus.route);
 	}
+	memory_usage::Usage route_slices = memory_usage::Measure(route_begins_);
+	route_slices += memory_usage::Measure(route_ends_);
+	route_slices += memory_usage::Measure(route_stops_);
+	route_slices += memory_usage::Measure(route_distances_);
+	return {
+		{ "names"s, names_.GetMemoryUsage() },
+		{ "stops"s, memory_usage::Measure(stops_) },
+		{ "buses"s, memory_usage::Measure(buses_) },
+		{ "bus routes"s, bus_routes },
+		{ "stops by name id"s, memory_usage::Measure(symbol_to_stop_) },
+		{ "buses by name id"s, memory_usage::Measure(symbol_to_bus_) },
+		{ "road distances"s, memory_usage::Measure(distance_between_stops_) },
+		{ "name index"s, name_index_.GetMemoryUsage() },
+		{ "stop points"s, stop_points_.GetMemoryUsage() },
+		{ "route slices"s, route_slices },
+		{ "buses by stop"s, memory_usage::Measure(stop_buses_) },
+		{ "bus statistics"s, memory_usage::Measure(bus_infos_) },
+		{ "graph"s, graph_.GetMemoryUsage() },
+		{ "edge payloads"s, graph_.GetPayloadMemoryUsage() },
+		{ "stop vertices"s, memory_usage::Measure(stop_vertices_) },
+		{ "ride lengths"s, memory_usage::Measure(ride_lengths_) },
+		{ "free edges"s, memory_usage::Measure(free_edges_) },
+	};
 }
 }
\ No newline at end of file
@@ -1,15 +1,20 @@
 #pragma once
+#include <cstdint>
 #include <deque>
 #include <functional>
+#include <limits>
 #include <optional>
 #include <set>
 #include <string>
 #include <string_view>
 #include <unordered_map>
+#include <vector>
 
 #include "domain.h"
 #include "graph.h"
-#include "router.h"
+#include "memory_usage.h"
+#include "string_pool.h"
+#include "transport_router.h"
 
 namespace transport_catalogue {
 
@@ -22,54 +27,201 @@ class TransportCatalogue {
 		double curvature;
 	};
 
-	struct StopsHasher {
-		size_t operator()(const std::pair<Stop*, Stop*>& stops) const {
-			static const size_t N = 37;
-			return bus_hasher_(stops.first) + N * bus_hasher_(stops.second);
-		}
-	private:
-		std::hash<Stop*> bus_hasher_;
-	};
-
 public:
-	void AddStop(const std::string& name, geo::Coordinates coordinates);
-
+	// Once the catalogue is finalized, the mutations below patch the statistics of the affected buses and,
+	// if the graph is created, only the ride edges out of the affected stops, keeping the other edge ids.
+	// Dropped edges are kept for reuse as dead loops until they make half of the graph, which is created
+	// again then. Before that they only change the data, and Finalize and CreateGraph are needed again.
+	// Routers built before a patch throw std::logic_error on queries and should be created again, except
+	// the plain and bidirectional Dijkstra ones, which read the graph on every query. With the graph
+	// created, a change that leaves a bus with a missing road distance throws std::out_of_range and
+	// changes nothing.
+	void AddStop(std::string_view name, geo::Coordinates coordinates);
+
+	// Also updates the distance of the pair, re-deriving the buses that go between the two stops.
 	void AddDistances(std::string_view main_name, std::string_view neighbour_name, int distance);
+	// The same with the stops given by id, which saves the lookups when loading stored data.
+	void AddDistances(StopId main_id, StopId neighbour_id, int distance);
+
+	void AddBus(std::string_view name, const std::vector<std::string_view>& str_route, bool ring);
+	void AddBus(std::string_view name, const std::vector<StopId>& route_ids, bool ring);
+
+	// The last bus takes the id and the place of the removed one in GetAllBuses, pointers to it change.
+	void RemoveBus(std::string_view name);
+
+	void UpdateBusRoute(std::string_view name, const std::vector<std::string_view>& str_route, bool ring);
 
-	void AddBus(const std::string& name, const std::vector<std::string_view>& str_route, bool ring);
+	// Lays stops and bus routes with their road distances out in id order and computes the statistics
+	// of every bus on up to thread_count threads, which GetBusInfo then only looks up. CreateGraph calls
+	// it itself.
+	void Finalize(size_t thread_count = 1);
 
+	// Re-weights an already created graph in place, its topology is kept.
 	void AddRoutingSettings(double bus_velocity, int bus_wait_time);
 
+	// Changes with every call of the mutations above and of AddRoutingSettings.
+	uint64_t GetGeneration() const;
+
+	double GetBusVelocity() const;
+
+	int GetBusWaitTime() const;
+
 	Bus* FindBus(std::string_view name) const;
 
 	Stop* FindStop(std::string_view name) const;
 
+	const std::deque<Stop>& GetAllStops() const;
+
 	const std::deque<Bus>& GetAllBuses() const;
 
+	// Every stored distance sorted by the ids of the stops. A distance added one way is stored both ways
+	// unless the other way is added too.
+	std::vector<RoadDistance> GetRoadDistances() const;
+
 	int GetDistance(std::string_view main_name, std::string_view neighbour_name) const;
 
+	// Before Finalize the statistics are computed from the bus route on every call.
 	BusInfo GetBusInfo(std::string_view name) const;
 
 	std::set<std::string_view> GetBusesPassingThroughStop(std::string_view stop) const;
 
-	std::optional<RouteInfo> GetRouteInfo(std::string_view from, std::string_view to, const graph::Router<double>& router) const;
+	std::optional<RouteInfo> GetRouteInfo(std::string_view from, std::string_view to, const transport_router::TransportRouter& router,
+		graph::SearchStats* stats = nullptr) const;
+
+	// Row-major from x to table of total times, nullopt when there is no route.
+	std::vector<std::optional<double>> GetTravelTimes(const std::vector<std::string_view>& from, const std::vector<std::string_view>& to, const transport_router::TransportRouter& router, size_t thread_count) const;
 
 	const graph::DirectedWeightedGraph<double>& GetGraph() const;
 
-	void CreateGraph();
+	EdgeInfo GetEdgeInfo(graph::EdgeId edge_id) const;
+
+	// Ride edges are generated per bus on up to thread_count threads, edge ids do not depend on it.
+	// The vertices of a stop are renumbered by vertex_order, edge ids stay the same.
+	void CreateGraph(size_t thread_count = 1, transport_router::VertexOrder vertex_order = transport_router::VertexOrder::INPUT);
+
+	// Heap memory of every structure by name. The stops and buses count without their routes,
+	// which are an entry of their own, and the graph counts without its payloads.
+	memory_usage::Report GetMemoryUsage() const;
 
 private:
+	using StopVertices = std::pair<graph::VertexId, graph::VertexId>;
+
+	struct EdgePayload {
+		double time;
+		string_pool::SymbolId name_id;
+		int span_count;
+	};
+
+	struct NameEntry {
+		Stop* stop = nullptr;
+		Bus* bus = nullptr;
+	};
+
+	struct RideEdge {
+		graph::Edge<double> edge;
+		int route_lenght;
+		int span_count;
+	};
+
+	static constexpr size_t NOT_CHOSEN = std::numeric_limits<size_t>::max();
+
+	static constexpr int NO_DISTANCE = -1;
+
+	static constexpr int DEAD_SPAN_COUNT = -1;
+
+	static uint64_t GetStopPairKey(StopId from, StopId to) {
+		return static_cast<uint64_t>(from) << 32 | to;
+	}
+
+	// NO_DISTANCE when it is not set in either direction.
+	int FindDistance(StopId from, StopId to) const;
+	std::optional<BusInfo> ComputeBusInfo(BusId bus) const;
+	// The same from Bus::route, for a catalogue that is not finalized.
+	std::optional<BusInfo> ComputeBusInfo(const Bus& bus) const;
+
+	// Throws std::out_of_range for NO_DISTANCE.
+	static int CheckDistance(int distance);
+
+	// Throw std::out_of_range for unknown names like the lookups by name did before.
+	Stop* GetStop(std::string_view name) const;
+	Stop* GetStop(StopId id) const;
+	Bus* GetBus(std::string_view name) const;
+	const StopVertices& GetStopVertices(std::string_view name) const;
+
+	// Only the edges out of from when it is set.
+	std::vector<RideEdge> CreateRideEdges(BusId bus, std::optional<StopId> from = std::nullopt) const;
+
+	double ComputeEdgeTime(int span_count, int route_lenght) const;
+
+	// Throws std::out_of_range unless every hop of the route has a road distance.
+	void CheckRouteDistances(const std::vector<Stop*>& route) const;
+
+	void LayOutRoutes();
+
+	// Gives the bus a new slice after its route changed, laying all routes out again once the old slices
+	// take more than half of the space, and recomputes its statistics.
+	void UpdateRouteSlice(BusId bus);
+
+	void BuildNameIndex();
+
+	void SetNameEntry(string_pool::SymbolId name_id);
+
+	// Ids of the stops of the bus, sorted and unique.
+	static std::vector<StopId> GetRouteStops(const Bus& bus);
+
+	void LinkStopsToBus(const Bus& bus);
+
+	void UnlinkStopsFromBus(const Bus& bus);
+
+	// Regenerates the ride edges out of every stop in from_stops (sorted, unique) from the buses passing
+	// through it and applies the difference to the graph in one go.
+	void UpdateRideEdges(const std::vector<StopId>& from_stops);
+
+	// Ride edges with the same ends and span count collapse into the shortest one, on a tie the one added
+	// first, which is what every router picked among them. It takes the place of the first of them:
+	// result[i] is the edge to put at the place of edge i, NOT_CHOSEN for the places that are dropped.
+	std::vector<size_t> CollapseRideEdges(const std::vector<RideEdge>& edges, size_t thread_count) const;
+
+	void RenumberVertices(transport_router::VertexOrder vertex_order);
+
+	void ApplyRoutingSettings();
 
+	// Stop and bus names share the pool, the vectors below are indexed by symbol id.
+	string_pool::StringPool names_;
 	std::deque<Stop> stops_;
-	std::unordered_map<std::string_view, Stop*> stopname_to_stop_;
+	std::vector<Stop*> symbol_to_stop_;
 	std::deque<Bus> buses_;
-	std::unordered_map<std::string_view, Bus*> busname_to_bus_;
-	std::unordered_map<Stop*, std::set<std::string_view>> stop_to_busnames_;
-	std::unordered_map<std::pair<Stop*, Stop*>, int, StopsHasher> distance_between_stops_;
+	std::vector<Bus*> symbol_to_bus_;
+	// Ids of the buses passing through a stop by stop id, sorted and unique.
+	std::vector<std::vector<BusId>> stop_buses_;
+	std::unordered_map<uint64_t, int> distance_between_stops_;
+	uint64_t generation_ = 0;
+	bool finalized_ = false;
+	// Built by Finalize, the lookups by name use it once the catalogue is finalized.
+	string_pool::FrozenIndex<NameEntry> name_index_;
+	// Filled by Finalize: points by stop id, and the stops of every bus one after another with the road
+	// distance from the previous stop (0 for the first one). Bus b has [route_begins_[b], route_ends_[b]),
+	// a changed route gets a new slice at the end and Finalize drops the old ones.
+	geo::PointSet stop_points_;
+	std::vector<size_t> route_begins_;
+	std::vector<size_t> route_ends_;
+	std::vector<StopId> route_stops_;
+	std::vector<int> route_distances_;
+	size_t stale_route_size_ = 0;
+	// nullopt for the buses with a missing road distance.
+	std::vector<std::optional<BusInfo>> bus_infos_;
 	double bus_velocity_ = 40.;
 	int bus_wait_time_ = 6;
-	graph::DirectedWeightedGraph<double> graph_;
-	std::unordered_map<std::string_view, std::pair<graph::VertexId, graph::VertexId>> stopname_to_vertex_;
-	std::unordered_map<int, EdgeInfo> edge_id_to_edge_;
+	bool graph_created_ = false;
+	// What the graph was created with, to create it again.
+	size_t graph_thread_count_ = 1;
+	transport_router::VertexOrder vertex_order_ = transport_router::VertexOrder::INPUT;
+	graph::PayloadGraph<double, EdgePayload> graph_;
+	std::vector<StopVertices> stop_vertices_;
+	// Road length of every ride edge by edge id, 0 for waiting edges.
+	std::vector<int> ride_lengths_;
+	// Edges dropped by the patches are loops of infinite weight with a span count of DEAD_SPAN_COUNT,
+	// their ids are taken again for new ride edges. There are fewer of them than of the other edges.
+	std::vector<graph::EdgeId> free_edges_;
 };
 }
\ No newline at end of file
@@ -0,0 +1,184 @@
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "transport_router.h"
+
+namespace transport_router {
+
+RouterType ParseRouterType(std::string_view name) {
+    using namespace std::literals::string_literals;
+    if (name == "floyd_warshall"s) {
+        return RouterType::FLOYD_WARSHALL;
+    }
+    if (name == "dijkstra"s) {
+        return RouterType::DIJKSTRA;
+    }
+    if (name == "contraction_hierarchy"s) {
+        return RouterType::CONTRACTION_HIERARCHY;
+    }
+    if (name == "caching_dijkstra"s) {
+        return RouterType::CACHING_DIJKSTRA;
+    }
+    if (name == "raptor"s) {
+        return RouterType::RAPTOR;
+    }
+    if (name == "bidirectional_dijkstra"s) {
+        return RouterType::BIDIRECTIONAL_DIJKSTRA;
+    }
+    if (name == "alt"s) {
+        return RouterType::ALT;
+    }
+    throw std::invalid_argument("Unknown router type: "s + std::string(name));
+}
+
+VertexOrder ParseVertexOrder(std::string_view name) {
+    using namespace std::literals::string_literals;
+    if (name == "input"s) {
+        return VertexOrder::INPUT;
+    }
+    if (name == "hilbert"s) {
+        return VertexOrder::HILBERT;
+    }
+    if (name == "rcm"s) {
+        return VertexOrder::REVERSE_CUTHILL_MCKEE;
+    }
+    throw std::invalid_argument("Unknown vertex order: "s + std::string(name));
+}
+
+TransportRouter::TransportRouter(const graph::DirectedWeightedGraph<double>& graph, const RouterSettings& settings)
+    : router_(CreateRouter(graph, settings))
+    , graph_(&graph)
+    , graph_generation_(graph.GetGeneration())
+{
+}
+
+TransportRouter::TransportRouter(const graph::DirectedWeightedGraph<double>& graph, graph::MappedRouter<double> router)
+    : router_(std::move(router))
+    , graph_(&graph)
+    , graph_generation_(graph.GetGeneration())
+{
+}
+
+TransportRouter::TransportRouter(line_router::LineRouter router)
+    : router_(std::move(router))
+{
+}
+
+TransportRouter::TransportRouter(const graph::DirectedWeightedGraph<double>& graph, graph::AltRouter<double> router)
+    : router_(std::move(router))
+    , graph_(&graph)
+    , graph_generation_(graph.GetGeneration())
+{
+}
+
+std::optional<TransportRouter::RouteInfo> TransportRouter::BuildRoute(graph::VertexId from, graph::VertexId to,
+                                                                     graph::SearchStats* stats) const {
+    return std::visit([this, from, to, stats](const auto& router) -> std::optional<RouteInfo> {
+        using Router = std::decay_t<decltype(router)>;
+        if constexpr (std::is_same_v<Router, line_router::LineRouter>) {
+            throw std::logic_error("Line router has no graph vertices");
+        }
+        else {
+            if constexpr (!std::is_same_v<Router, graph::DijkstraRouter<double>>
+                          && !std::is_same_v<Router, graph::BidirectionalDijkstraRouter<double>>) {
+                if (graph_->GetGeneration() != graph_generation_) {
+                    throw std::logic_error("The graph changed after the router was built");
+                }
+            }
+            if constexpr (std::is_same_v<Router, graph::DijkstraRouter<double>>
+                          || std::is_same_v<Router, graph::AltRouter<double>>) {
+                return router.BuildRoute(from, to, stats);
+            }
+            else {
+                return router.BuildRoute(from, to);
+            }
+        }
+    }, router_);
+}
+
+bool TransportRouter::CountsSettledVertices() const {
+    return std::holds_alternative<graph::DijkstraRouter<double>>(router_)
+        || std::holds_alternative<graph::AltRouter<double>>(router_);
+}
+
+std::optional<graph::ShortestPathCacheStats> TransportRouter::GetCacheStats() const {
+    if (const auto* router = std::get_if<graph::CachingRouter<double>>(&router_)) {
+        return router->GetCacheStats();
+    }
+    return std::nullopt;
+}
+
+const graph::Router<double>* TransportRouter::GetAllPairsRouter() const {
+    return std::get_if<graph::Router<double>>(&router_);
+}
+
+const line_router::LineRouter* TransportRouter::GetLineRouter() const {
+    return std::get_if<line_router::LineRouter>(&router_);
+}
+
+const graph::AltRouter<double>* TransportRouter::GetAltRouter() const {
+    return std::get_if<graph::AltRouter<double>>(&router_);
+}
+
+memory_usage::Report TransportRouter::GetMemoryUsage() const {
+    using namespace std::literals::string_literals;
+    return std::visit([](const auto& router) -> memory_usage::Report {
+        using Router = std::decay_t<decltype(router)>;
+        if constexpr (std::is_same_v<Router, graph::Router<double>> || std::is_same_v<Router, graph::Router<double, float>>) {
+            return {{"all-pairs weights"s, memory_usage::Measure(router.GetWeights())},
+                    {"all-pairs previous edges"s, memory_usage::Measure(router.GetPrevEdges())}};
+        }
+        else if constexpr (std::is_same_v<Router, graph::AltRouter<double>>) {
+            const auto& tables = router.GetLandmarkTables();
+            memory_usage::Usage usage = memory_usage::Measure(tables.landmarks);
+            usage += memory_usage::Measure(tables.to_landmarks);
+            usage += memory_usage::Measure(tables.from_landmarks);
+            return {{"landmark tables"s, usage}};
+        }
+        else if constexpr (std::is_same_v<Router, graph::ContractionHierarchyRouter<double>>) {
+            return {{"contraction hierarchy"s, router.GetMemoryUsage()}};
+        }
+        else if constexpr (std::is_same_v<Router, graph::CachingRouter<double>>) {
+            return {{"shortest path cache"s, router.GetMemoryUsage()}};
+        }
+        else if constexpr (std::is_same_v<Router, graph::MappedRouter<double>>) {
+            memory_usage::Usage usage;
+            usage.bytes = router.GetTableBytes();
+            return {{"all-pairs tables (mapped)"s, usage}};
+        }
+        else if constexpr (std::is_same_v<Router, line_router::LineRouter>) {
+            return {{"bus lines"s, router.GetMemoryUsage()}};
+        }
+        else {
+            return {};
+        }
+    }, router_);
+}
+
+TransportRouter::AnyRouter TransportRouter::CreateRouter(const graph::DirectedWeightedGraph<double>& graph,
+                                                        const RouterSettings& settings) {
+    switch (settings.type) {
+    case RouterType::DIJKSTRA:
+        return graph::DijkstraRouter<double>(graph);
+    case RouterType::BIDIRECTIONAL_DIJKSTRA:
+        return graph::BidirectionalDijkstraRouter<double>(graph);
+    case RouterType::ALT:
+        return graph::AltRouter<double>(graph, settings.landmark_count, settings.thread_count);
+    case RouterType::CONTRACTION_HIERARCHY:
+        return graph::ContractionHierarchyRouter<double>(graph);
+    case RouterType::CACHING_DIJKSTRA:
+        return graph::CachingRouter<double>(graph, settings.cache_budget_bytes);
+    case RouterType::RAPTOR:
+        throw std::invalid_argument("Line router is built from the catalogue");
+    case RouterType::FLOYD_WARSHALL:
+    default:
+        if (settings.float_weights) {
+            return graph::Router<double, float>(graph, settings.thread_count);
+        }
+        return graph::Router<double>(graph, settings.thread_count);
+    }
+}
+
+} // transport_router
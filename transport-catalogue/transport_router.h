@@ -0,0 +1,110 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+
+#include "alt_router.h"
+#include "bidirectional_dijkstra_router.h"
+#include "caching_router.h"
+#include "contraction_router.h"
+#include "dijkstra_router.h"
+#include "graph.h"
+#include "line_router.h"
+#include "mapped_router.h"
+#include "memory_usage.h"
+#include "router.h"
+
+namespace transport_router {
+
+enum class RouterType {
+    FLOYD_WARSHALL,
+    DIJKSTRA,
+    CONTRACTION_HIERARCHY,
+    CACHING_DIJKSTRA,
+    RAPTOR,
+    BIDIRECTIONAL_DIJKSTRA,
+    ALT,
+};
+
+RouterType ParseRouterType(std::string_view name);
+
+// Numbering of the graph vertices: stops in input order, along a space-filling curve over their
+// coordinates or in reverse Cuthill-McKee order of the stops' graph.
+enum class VertexOrder {
+    INPUT,
+    HILBERT,
+    REVERSE_CUTHILL_MCKEE,
+};
+
+VertexOrder ParseVertexOrder(std::string_view name);
+
+struct RouterSettings {
+    RouterType type = RouterType::FLOYD_WARSHALL;
+    size_t thread_count = 1;
+    bool float_weights = false;
+    size_t cache_budget_bytes = 64 * 1024 * 1024;
+    size_t landmark_count = 16;
+    VertexOrder vertex_order = VertexOrder::INPUT;
+    // Floyd-Warshall or ALT landmark tables are loaded from and saved to this file when it is set.
+    std::string table_file;
+    // Route responses get the query latency and, for the engines that count them, settled vertices.
+    bool query_stats = false;
+};
+
+class TransportRouter {
+public:
+    using RouteInfo = graph::Router<double>::RouteInfo;
+
+    // Except for the plain and bidirectional Dijkstra ones, which read the graph on every query, the
+    // router answers for the graph as it is now: once the graph changes, BuildRoute throws
+    // std::logic_error and the router should be created again.
+    TransportRouter(const graph::DirectedWeightedGraph<double>& graph, const RouterSettings& settings);
+
+    // The router was loaded for graph, which is checked for changes like above.
+    TransportRouter(const graph::DirectedWeightedGraph<double>& graph, graph::MappedRouter<double> router);
+
+    // Works on the catalogue's bus routes instead of the graph, see GetLineRouter.
+    explicit TransportRouter(line_router::LineRouter router);
+
+    TransportRouter(const graph::DirectedWeightedGraph<double>& graph, graph::AltRouter<double> router);
+
+    // stats stays untouched unless the engine counts settled vertices, see CountsSettledVertices.
+    std::optional<RouteInfo> BuildRoute(graph::VertexId from, graph::VertexId to, graph::SearchStats* stats = nullptr) const;
+
+    bool CountsSettledVertices() const;
+
+    std::optional<graph::ShortestPathCacheStats> GetCacheStats() const;
+
+    // Null unless the router holds freshly built Floyd-Warshall tables in double.
+    const graph::Router<double>* GetAllPairsRouter() const;
+
+    // Not null for RouterType::RAPTOR, which answers by stops and has no graph vertices to pass to BuildRoute.
+    const line_router::LineRouter* GetLineRouter() const;
+
+    const graph::AltRouter<double>* GetAltRouter() const;
+
+    // What the engine keeps between queries, nothing for the plain and bidirectional Dijkstra ones.
+    memory_usage::Report GetMemoryUsage() const;
+
+private:
+    using AnyRouter = std::variant<graph::Router<double>,
+                                   graph::Router<double, float>,
+                                   graph::DijkstraRouter<double>,
+                                   graph::BidirectionalDijkstraRouter<double>,
+                                   graph::AltRouter<double>,
+                                   graph::ContractionHierarchyRouter<double>,
+                                   graph::CachingRouter<double>,
+                                   graph::MappedRouter<double>,
+                                   line_router::LineRouter>;
+
+    AnyRouter router_;
+    // Null for the line router.
+    const graph::DirectedWeightedGraph<double>* graph_ = nullptr;
+    uint64_t graph_generation_ = 0;
+
+    static AnyRouter CreateRouter(const graph::DirectedWeightedGraph<double>& graph, const RouterSettings& settings);
+};
+
+}
@@ -0,0 +1,105 @@
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <numeric>
+#include <utility>
+
+#include "vertex_order.h"
+
+namespace vertex_order {
+
+namespace {
+
+constexpr uint32_t CURVE_SIDE = 1 << 16;
+
+uint64_t GetHilbertIndex(uint32_t x, uint32_t y) {
+    uint64_t index = 0;
+    for (uint32_t side = CURVE_SIDE / 2; side > 0; side /= 2) {
+        const uint32_t rx = (x & side) > 0;
+        const uint32_t ry = (y & side) > 0;
+        index += static_cast<uint64_t>(side) * side * ((3 * rx) ^ ry);
+        if (ry == 0) {
+            if (rx == 1) {
+                x = CURVE_SIDE - 1 - x;
+                y = CURVE_SIDE - 1 - y;
+            }
+            std::swap(x, y);
+        }
+    }
+    return index;
+}
+
+uint32_t ToCell(double value, double min_value, double max_value) {
+    if (max_value <= min_value) {
+        return 0;
+    }
+    const double cell = (value - min_value) / (max_value - min_value) * (CURVE_SIDE - 1);
+    return static_cast<uint32_t>(std::clamp(cell, 0., static_cast<double>(CURVE_SIDE - 1)));
+}
+
+}
+
+std::vector<size_t> SpaceFillingCurveOrder(const std::vector<geo::Coordinates>& points) {
+    std::vector<size_t> order(points.size());
+    std::iota(order.begin(), order.end(), 0);
+    if (points.empty()) {
+        return order;
+    }
+    auto [min_lat, max_lat] = std::pair{ points[0].lat, points[0].lat };
+    auto [min_lng, max_lng] = std::pair{ points[0].lng, points[0].lng };
+    for (const geo::Coordinates& point : points) {
+        min_lat = std::min(min_lat, point.lat);
+        max_lat = std::max(max_lat, point.lat);
+        min_lng = std::min(min_lng, point.lng);
+        max_lng = std::max(max_lng, point.lng);
+    }
+    std::vector<uint64_t> indices;
+    indices.reserve(points.size());
+    for (const geo::Coordinates& point : points) {
+        indices.push_back(GetHilbertIndex(ToCell(point.lng, min_lng, max_lng), ToCell(point.lat, min_lat, max_lat)));
+    }
+    std::stable_sort(order.begin(), order.end(), [&indices](size_t lhs, size_t rhs) {
+        return indices[lhs] < indices[rhs];
+    });
+    return order;
+}
+
+std::vector<size_t> ReverseCuthillMcKeeOrder(const std::vector<std::vector<size_t>>& adjacency) {
+    const size_t count = adjacency.size();
+    auto by_degree = [&adjacency](size_t lhs, size_t rhs) {
+        return std::pair{ adjacency[lhs].size(), lhs } < std::pair{ adjacency[rhs].size(), rhs };
+    };
+    std::vector<size_t> starts(count);
+    std::iota(starts.begin(), starts.end(), 0);
+    std::sort(starts.begin(), starts.end(), by_degree);
+
+    std::vector<size_t> order;
+    order.reserve(count);
+    std::vector<bool> visited(count, false);
+    std::vector<size_t> neighbours;
+    for (const size_t start : starts) {
+        if (visited[start]) {
+            continue;
+        }
+        visited[start] = true;
+        std::deque<size_t> queue = { start };
+        while (!queue.empty()) {
+            const size_t vertex = queue.front();
+            queue.pop_front();
+            order.push_back(vertex);
+            neighbours.clear();
+            for (const size_t neighbour : adjacency[vertex]) {
+                if (!visited[neighbour]) {
+                    visited[neighbour] = true;
+                    neighbours.push_back(neighbour);
+                }
+            }
+            std::sort(neighbours.begin(), neighbours.end(), by_degree);
+            queue.insert(queue.end(), neighbours.begin(), neighbours.end());
+        }
+    }
+    std::reverse(order.begin(), order.end());
+    return order;
+}
+
+} // vertex_order
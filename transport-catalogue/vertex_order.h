@@ -0,0 +1,17 @@
+#pragma once
+#include <vector>
+
+#include "geo.h"
+
+namespace vertex_order {
+
+// Both functions return a permutation of [0, n): the item that goes first, second and so on.
+
+// Orders points along a Hilbert curve over their bounding box, so neighbours on the map stay close.
+std::vector<size_t> SpaceFillingCurveOrder(const std::vector<geo::Coordinates>& points);
+
+// Reverse Cuthill-McKee order of an undirected graph given by adjacency lists: breadth-first
+// from a vertex of minimal degree in every component, neighbours by increasing degree.
+std::vector<size_t> ReverseCuthillMcKeeOrder(const std::vector<std::vector<size_t>>& adjacency);
+
+} // vertex_order